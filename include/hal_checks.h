@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief Compile-time argument checks, shared by the HAL modules.
+ *
+ * ## Release Build
+ *
+ * By default, every function validates its arguments and returns an error
+ * result for invalid ones. If `HAL_RELEASE_BUILD` is defined (see the
+ * `HAL_RELEASE_BUILD` CMake option), these run-time checks are compiled out:
+ *
+ * - Arguments that are compile-time constants are still checked, and an
+ *   invalid one breaks the build with HAL_CHECK_CONSTANT_ARGUMENT().
+ *   Headers do this with inline wrappers, see HAL_CHECKED_INLINE.
+ * - Other arguments are not checked at all. Passing an invalid one is
+ *   undefined behaviour.
+ *
+ * Result enums are kept as is, for API compatibility. Only their error values
+ * are not returned anymore.
+ *
+ * Constant checks need optimizations to be enabled, so that constants are
+ * propagated. Otherwise only literal arguments are checked.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef __HAL_CHECKS_H
+#define __HAL_CHECKS_H
+
+/**
+ * Breaks the build if `condition` is false. Evaluates to an `int` with the
+ * value of 0, so it can be used inside of other expressions.
+ *
+ * `condition` must be an integer constant expression. Passing a run-time value
+ * is a compile error too.
+ */
+#define HAL_STATIC_ASSERT(condition)                                           \
+    ((int)(0 * sizeof(struct { int assertion : (condition) ? 1 : -1; })))
+
+#if defined(HAL_RELEASE_BUILD)
+/**
+ * Never defined. A call to it, that is not optimized away, breaks the build.
+ */
+void hal_checks_invalid_constant_argument(void)
+    __attribute__((error("invalid constant argument to a HAL function")));
+
+/**
+ * Breaks the build if `condition` is known to be false at compile time.
+ * Otherwise does nothing and doesn't evaluate `condition`.
+ */
+#define HAL_CHECK_CONSTANT_ARGUMENT(condition)                                 \
+    do {                                                                       \
+        if (__builtin_constant_p(condition) && !(condition)) {                 \
+            hal_checks_invalid_constant_argument();                            \
+        }                                                                      \
+    } while (0)
+
+/**
+ * Wrappers that check the arguments of a function, before calling it. Headers
+ * define each wrapper as `<function>_checked_` and replace the function with
+ * it, using an object-like macro. Wrappers are always inlined, so that
+ * constant arguments of the caller are visible to the checks.
+ */
+#define HAL_CHECKED_INLINE static inline __attribute__((always_inline))
+#endif // HAL_RELEASE_BUILD
+
+#endif // __HAL_CHECKS_H
@@ -21,6 +21,8 @@
 #ifndef __HAL_CLOCK_H
 #define __HAL_CLOCK_H
 
+#include "hal_checks.h"
+
 #include <stdint.h>
 
 /// @brief Module specific errors for the clock related stuff.
@@ -70,4 +72,16 @@ enum hal_clock_prescaler_division_rates hal_clock_get_clock_prescaler();
 enum hal_result_clock hal_clock_change_clock_prescaler(
     enum hal_clock_prescaler_division_rates divisor);
 
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_clock
+hal_clock_change_clock_prescaler_checked_(
+    enum hal_clock_prescaler_division_rates divisor) {
+    HAL_CHECK_CONSTANT_ARGUMENT(divisor <= hal_clock_prescaler_256);
+    return hal_clock_change_clock_prescaler(divisor);
+}
+#define hal_clock_change_clock_prescaler                                       \
+    hal_clock_change_clock_prescaler_checked_
+#endif // HAL_RELEASE_BUILD
+
 #endif // __HAL_CLOCK_H
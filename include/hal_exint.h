@@ -0,0 +1,208 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief External interrupts: INT0, INT1 and pin change interrupts
+ *
+ * ## Capabilities
+ *
+ * - Configure sense control of INT0 and INT1 via hal_exint_configure()
+ * - Enable, disable or clear INT0 and INT1 via hal_exint_enable(),
+ *   hal_exint_disable() and hal_exint_clear()
+ * - Enable pin change interrupts for any pins of a port via
+ *   hal_exint_pin_change_enable()
+ * - Bind interrupt handlers at compile time
+ *
+ * ## Binding Handlers
+ *
+ * Handlers are bound with macros that expand to an `ISR()`, so that there
+ * isn't a run-time function pointer. If handler is a `static inline` function,
+ * it will be inlined in the interrupt service routine and only the registers
+ * that it uses will be saved.
+ *
+ * Pin change interrupts are grouped per port: PCINT0 for port B, PCINT1 for
+ * port C and PCINT2 for port D. Their handlers will get the enabled pins that
+ * are changed since the last interrupt, with a single PINx read.
+ *
+ * Code example:
+ *
+ * ```c
+ * static inline void on_int0(void) { hal_io_fast_toggle(LED); }
+ * HAL_EXINT_INT0_ISR(on_int0)
+ *
+ * static inline void on_port_d_change(uint8_t changed, uint8_t pins) {
+ *     if (changed & pins & _BV(4)) {
+ *         // PD4 is changed to high.
+ *     }
+ * }
+ * HAL_EXINT_PCINT2_ISR(on_port_d_change)
+ *
+ * int main() {
+ *     hal_exint_configure(hal_exint_int0, hal_exint_sense_falling_edge);
+ *     hal_exint_enable(hal_exint_int0);
+ *     hal_exint_pin_change_enable(hal_io_port_d, _BV(4) | _BV(5));
+ *     sei();
+ *     ...
+ * }
+ * ```
+ *
+ * ## Function Return Type
+ *
+ * Every external interrupt function will return \ref hal_result_exint. This
+ * value can be checked if operation were successful or weren't.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef __HAL_EXINT_H
+#define __HAL_EXINT_H
+
+#include "hal_io.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stdint.h>
+
+/// @brief Module specific return results.
+enum hal_result_exint {
+    hal_result_exint_ok = 0,            ///< Operation was successful
+    hal_result_exint_invalid_interrupt, ///< An invalid interrupt is specified
+    hal_result_exint_invalid_sense,     ///< An invalid sense control is
+                                        ///< specified
+    hal_result_exint_invalid_port,      ///< An invalid port is specified
+};
+
+/**
+ * @brief External interrupts.
+ *
+ * Enum values matches register bits for that interrupt.
+ * */
+enum hal_exint_interrupt {
+    hal_exint_int0 = 0, ///< INT0, on PD2
+    hal_exint_int1 = 1  ///< INT1, on PD3
+};
+
+/**
+ * @brief Sense control of the external interrupts.
+ *
+ * Enum values matches register value for that setting.
+ * */
+enum hal_exint_sense {
+    hal_exint_sense_low_level = 0, ///< Low level generates an interrupt
+    hal_exint_sense_any_edge,      ///< Any logical change generates an
+                                   ///< interrupt
+    hal_exint_sense_falling_edge,  ///< Falling edge generates an interrupt
+    hal_exint_sense_rising_edge    ///< Rising edge generates an interrupt
+};
+
+/**
+ * Last PINx values that pin change interrupt handlers have seen, indexed by
+ * \ref hal_io_port.
+ */
+extern volatile uint8_t hal_exint_pin_snapshots[3];
+
+enum hal_result_exint hal_exint_configure(enum hal_exint_interrupt interrupt,
+                                          enum hal_exint_sense sense);
+enum hal_result_exint hal_exint_enable(enum hal_exint_interrupt interrupt);
+enum hal_result_exint hal_exint_disable(enum hal_exint_interrupt interrupt);
+enum hal_result_exint hal_exint_clear(enum hal_exint_interrupt interrupt);
+enum hal_result_exint hal_exint_pin_change_enable(enum hal_io_port port,
+                                                  uint8_t mask);
+enum hal_result_exint hal_exint_pin_change_disable(enum hal_io_port port);
+
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_configure_checked_(enum hal_exint_interrupt interrupt,
+                             enum hal_exint_sense sense) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_exint_int1);
+    HAL_CHECK_CONSTANT_ARGUMENT(sense <= hal_exint_sense_rising_edge);
+    return hal_exint_configure(interrupt, sense);
+}
+#define hal_exint_configure hal_exint_configure_checked_
+
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_enable_checked_(enum hal_exint_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_exint_int1);
+    return hal_exint_enable(interrupt);
+}
+#define hal_exint_enable hal_exint_enable_checked_
+
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_disable_checked_(enum hal_exint_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_exint_int1);
+    return hal_exint_disable(interrupt);
+}
+#define hal_exint_disable hal_exint_disable_checked_
+
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_clear_checked_(enum hal_exint_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_exint_int1);
+    return hal_exint_clear(interrupt);
+}
+#define hal_exint_clear hal_exint_clear_checked_
+
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_pin_change_enable_checked_(enum hal_io_port port, uint8_t mask) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_exint_pin_change_enable(port, mask);
+}
+#define hal_exint_pin_change_enable hal_exint_pin_change_enable_checked_
+
+HAL_CHECKED_INLINE enum hal_result_exint
+hal_exint_pin_change_disable_checked_(enum hal_io_port port) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_exint_pin_change_disable(port);
+}
+#define hal_exint_pin_change_disable hal_exint_pin_change_disable_checked_
+#endif // HAL_RELEASE_BUILD
+
+/**
+ * PCMSKx register of a port.
+ */
+#define HAL_EXINT_PCMSK_REGISTER(port) (*(&PCMSK0 + (uint8_t)(port)))
+
+#define HAL_EXINT_PIN_CHANGE_ISR_(vector, port, handler)                       \
+    ISR(vector) {                                                              \
+        uint8_t pins = HAL_IO_PIN_REGISTER(port);                              \
+        uint8_t changed = pins ^ hal_exint_pin_snapshots[port];                \
+                                                                               \
+        hal_exint_pin_snapshots[port] = pins;                                  \
+        handler(changed & HAL_EXINT_PCMSK_REGISTER(port), pins);               \
+    }
+
+/**
+ * Binds `void handler(void)` to INT0.
+ */
+#define HAL_EXINT_INT0_ISR(handler) ISR(INT0_vect) { handler(); }
+
+/**
+ * Binds `void handler(void)` to INT1.
+ */
+#define HAL_EXINT_INT1_ISR(handler) ISR(INT1_vect) { handler(); }
+
+/**
+ * Binds `void handler(uint8_t changed, uint8_t pins)` to pin change interrupts
+ * of port B. `changed` has the enabled pins that are changed and `pins` has
+ * the PINB value.
+ */
+#define HAL_EXINT_PCINT0_ISR(handler)                                          \
+    HAL_EXINT_PIN_CHANGE_ISR_(PCINT0_vect, hal_io_port_b, handler)
+
+/**
+ * Binds `void handler(uint8_t changed, uint8_t pins)` to pin change interrupts
+ * of port C. `changed` has the enabled pins that are changed and `pins` has
+ * the PINC value.
+ */
+#define HAL_EXINT_PCINT1_ISR(handler)                                          \
+    HAL_EXINT_PIN_CHANGE_ISR_(PCINT1_vect, hal_io_port_c, handler)
+
+/**
+ * Binds `void handler(uint8_t changed, uint8_t pins)` to pin change interrupts
+ * of port D. `changed` has the enabled pins that are changed and `pins` has
+ * the PIND value.
+ */
+#define HAL_EXINT_PCINT2_ISR(handler)                                          \
+    HAL_EXINT_PIN_CHANGE_ISR_(PCINT2_vect, hal_io_port_d, handler)
+
+#endif // __HAL_EXINT_H
@@ -10,6 +10,7 @@
 #ifndef __HAL_INTERNALS_H
 #define __HAL_INTERNALS_H
 
+#include <avr/interrupt.h>
 #include <avr/io.h>
 
 /**
@@ -27,4 +28,42 @@
  * */
 #define SET_BIT(var, bit) ((var) |= BIT(bit))
 
+/**
+ * Save global interrupt flag to `sreg` and disable interrupts.
+ * */
+#define ENTER_CRITICAL(sreg)                                                   \
+    do {                                                                       \
+        (sreg) = SREG;                                                         \
+        cli();                                                                 \
+    } while (0)
+
+/**
+ * Restore global interrupt flag from `sreg`, saved by `ENTER_CRITICAL`.
+ * */
+#define EXIT_CRITICAL(sreg) (SREG = (sreg))
+
+/**
+ * Returns `error` if `invalid` is true. Compiled out in release builds, see
+ * hal_checks.h.
+ * */
+#if defined(HAL_RELEASE_BUILD)
+#define CHECK_ARGUMENT(invalid, error)
+#else
+#define CHECK_ARGUMENT(invalid, error)                                         \
+    if (invalid) {                                                             \
+        return error;                                                          \
+    }
+#endif // HAL_RELEASE_BUILD
+
+/**
+ * Returns `error` from the `default` case of a switch over an argument. In
+ * release builds, marks it as unreachable instead, so that the switch doesn't
+ * need a range check.
+ * */
+#if defined(HAL_RELEASE_BUILD)
+#define INVALID_ARGUMENT(error) __builtin_unreachable()
+#else
+#define INVALID_ARGUMENT(error) return error
+#endif // HAL_RELEASE_BUILD
+
 #endif // __HAL_INTERNALS_H
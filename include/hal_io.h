@@ -12,11 +12,154 @@
  *   hal_io_write()
  *   - Toggle pin output signal when pin is configured as output
  * - Pin state reading when pin is configured as input via hal_io_read()
+ * - Configure multiple pins from a table, with a few register writes per port,
+ *   via hal_io_configure_many() or hal_io_configure_many_P()
+ * - Whole port operations, that update multiple pins with a single register
+ *   write:
+ *   - Write a full port via hal_io_write_port()
+ *   - Set and clear pins of a port atomically via hal_io_modify_port()
+ *   - Toggle pins of a port via hal_io_toggle_port()
+ *   - Read all pins of a port via hal_io_read_port()
+ * - Virtual parallel buses that span multiple ports via \ref hal_io_bus
+ * - Debounce all pins of a port in parallel via \ref hal_io_debouncer
+ * - Cycle counted bitstream output for WS2812 style LEDs via
+ *   hal_io_bitstream_write()
+ * - Single instruction write, toggle and read of pins that are known at compile
+ *   time, via hal_io_fast_write(), hal_io_fast_toggle() and hal_io_fast_read()
  *
  * ## Function Return Type
  *
  * Every I/O function will return \ref hal_result_io. This value can be checked
  * if operation were successful or weren't.
+ *
+ * ## Configuring Multiple Pins
+ *
+ * A constant table of \ref hal_io_pin_configuration_entry can be applied at
+ * once. Pins are grouped per port and each port is updated with at most 3
+ * register writes, while following the same intermediate steps as
+ * hal_io_configure(). If a pin is listed more than once, the last entry is
+ * used. Table can be placed in the program memory to save RAM:
+ *
+ * ```c
+ * static const struct hal_io_pin_configuration_entry pins[] PROGMEM = {
+ *     {{hal_io_port_b, 5}, {hal_io_direction_output, 0}},
+ *     {{hal_io_port_d, 2}, {hal_io_direction_input, 1}},
+ *     {{hal_io_port_d, 3}, {hal_io_direction_input, 0}},
+ * };
+ *
+ * result = hal_io_configure_many_P(pins, sizeof pins / sizeof pins[0]);
+ * ```
+ *
+ * ## Extras
+ *
+ * ### Parallel Bus
+ *
+ * Pins of a parallel bus don't need to be on the same port or in order.
+ * hal_io_bus_init() splits the bus into runs of consecutive pins and
+ * precomputes a port mask and a shift for each of them. Shifts are done with a
+ * hardware multiplication, instead of a loop for each bit. After that, a byte is
+ * written with a single atomic read-modify-write per port and read with a
+ * single PINx read per port, followed by an optional strobe pulse.
+ *
+ * Code example:
+ *
+ * ```c
+ * // D0-D5 on PD2-PD7 and D6-D7 on PB0-PB1, as PD0 and PD1 are used by USART.
+ * static const struct hal_io_pin data_pins[8] = {
+ *     {hal_io_port_d, 2}, {hal_io_port_d, 3}, {hal_io_port_d, 4},
+ *     {hal_io_port_d, 5}, {hal_io_port_d, 6}, {hal_io_port_d, 7},
+ *     {hal_io_port_b, 0}, {hal_io_port_b, 1},
+ * };
+ * static const struct hal_io_pin strobe = {hal_io_port_b, 2};
+ * struct hal_io_bus bus;
+ *
+ * hal_io_bus_init(&bus, data_pins, 8, &strobe);
+ * hal_io_bus_set_direction(&bus, hal_io_direction_output);
+ * hal_io_bus_write(&bus, 0xA5);
+ * ```
+ *
+ * ### Debouncer
+ *
+ * \ref hal_io_debouncer samples whole PINx register on each call to
+ * hal_io_debouncer_tick() and debounces all 8 pins of the port in parallel,
+ * with a 2 bit vertical counter per pin. A pin's debounced state changes after
+ * it reads the same new value for 4 ticks in a row. Changes are collected as
+ * pressed (became active) and released (became inactive) masks, until they
+ * are read.
+ *
+ * Ticks should come from a periodic interrupt, like timer0's compare match.
+ * Code example, with a 10 ms tick at 16 MHz:
+ *
+ * ```c
+ * struct hal_io_debouncer buttons;
+ *
+ * ISR(TIMER0_COMPA_vect) { hal_io_debouncer_tick(&buttons); }
+ *
+ * int main() {
+ *     // Buttons on PD4-PD7 pull pins to the ground when pressed.
+ *     hal_io_debouncer_init(&buttons, hal_io_port_d, 0xF0);
+ *
+ *     OCR0A = 155;
+ *     TIMSK0 |= _BV(OCIE0A);
+ *     hal_timer0_set_operation_mode(hal_timer0_mode_ctc);
+ *     hal_timer0_set_clock_source(hal_timer0_prescaler_1024);
+ *     sei();
+ *
+ *     while (1) {
+ *         if (hal_io_debouncer_get_pressed(&buttons, _BV(4))) {
+ *             // PD4 is pressed.
+ *         }
+ *     }
+ * }
+ * ```
+ *
+ * ### Bitstream Output
+ *
+ * hal_io_bitstream_write() sends bytes from RAM to WS2812 style single wire
+ * LEDs at 800 kbit/s. Each bit starts with a high pulse: 375 ns for a 0 and
+ * 750 ns for a 1, and lasts 1.25 µs in total. Timing is generated with cycle
+ * counted assembly, calculated from `F_CPU`, which must be at least 8 MHz.
+ * Below that, the library is built without it, with a warning.
+ *
+ * Interrupts are disabled while a frame is being sent, which is 30 µs for each
+ * RGB LED. After a frame, the line should stay low for at least 50 µs before
+ * the next frame, so that LEDs latch received colors.
+ *
+ * Code example:
+ *
+ * ```c
+ * static const struct hal_io_pin leds_pin = {hal_io_port_b, 0};
+ * uint8_t colors[3 * LED_COUNT]; // Green, red and blue for each LED.
+ *
+ * hal_io_configure(leds_pin, output_configuration);
+ * hal_io_write(leds_pin, hal_io_state_low);
+ * hal_io_bitstream_write(leds_pin, colors, sizeof colors);
+ * ```
+ *
+ * ## Fast Path
+ *
+ * If a pin is known at compile time, it can be given as a pin descriptor: A
+ * macro that expands to a constant port and a constant pin number. Fast path
+ * macros will then compile to a single `sbi`, `cbi` or `sbis`/`sbic`
+ * instruction, or an `out` to PINx for toggles. Invalid pins are rejected at
+ * compile time, so fast path macros don't return \ref hal_result_io.
+ *
+ * Code example:
+ *
+ * ```c
+ * #define LED hal_io_port_b, 5
+ * #define BUTTON hal_io_port_d, 2
+ *
+ * hal_io_fast_high(LED);
+ * hal_io_fast_toggle(LED);
+ *
+ * if (hal_io_fast_read(BUTTON) == hal_io_state_low) {
+ *     hal_io_fast_low(LED);
+ * }
+ *
+ * // Descriptors can be converted to a struct for the regular functions.
+ * hal_io_configure(hal_io_fast_pin(LED), configuration);
+ * ```
  * */
 
 // SPDX-FileCopyrightText: 2025 Ceyhun Şen <ceyhuusen@gmail.com>
@@ -25,6 +168,9 @@
 #ifndef __HAL_IO_H
 #define __HAL_IO_H
 
+#include "hal_checks.h"
+
+#include <avr/io.h>
 #include <stdint.h>
 
 /**
@@ -80,13 +226,298 @@ struct hal_io_pin_configuration {
     uint8_t is_pull_up;
 };
 
+/**
+ * Configuration of a single pin, used with hal_io_configure_many().
+ *
+ * @param io Pin to be configured.
+ * @param configuration How to configure the pin.
+ */
+struct hal_io_pin_configuration_entry {
+    struct hal_io_pin io;
+    struct hal_io_pin_configuration configuration;
+};
+
 enum hal_result_io
 hal_io_configure(struct hal_io_pin io,
                  struct hal_io_pin_configuration configuration);
+enum hal_result_io
+hal_io_configure_many(const struct hal_io_pin_configuration_entry *table,
+                      uint8_t count);
+enum hal_result_io
+hal_io_configure_many_P(const struct hal_io_pin_configuration_entry *table,
+                        uint8_t count);
 enum hal_result_io hal_io_write(struct hal_io_pin io,
                                 enum hal_io_pin_state state);
 enum hal_result_io hal_io_toggle(struct hal_io_pin io);
 enum hal_result_io hal_io_read(struct hal_io_pin io,
                                enum hal_io_pin_state *state);
 
+enum hal_result_io hal_io_write_port(enum hal_io_port port, uint8_t value);
+enum hal_result_io hal_io_modify_port(enum hal_io_port port, uint8_t set_mask,
+                                      uint8_t clear_mask);
+enum hal_result_io hal_io_toggle_port(enum hal_io_port port, uint8_t mask);
+enum hal_result_io hal_io_read_port(enum hal_io_port port, uint8_t *value);
+
+/**
+ * A port that has some of the pins of a \ref hal_io_bus.
+ *
+ * @param port_register PORTx register of the port.
+ * @param pin_register PINx register of the port.
+ * @param mask Bus pins of the port.
+ */
+struct hal_io_bus_port {
+    volatile uint8_t *port_register;
+    volatile uint8_t *pin_register;
+    uint8_t mask;
+};
+
+/**
+ * Consecutive data bits of a \ref hal_io_bus, that are on consecutive pins of
+ * the same port.
+ *
+ * @param port_index Index of the port in \ref hal_io_bus's `ports`.
+ * @param data_mask Data bits that are in this segment.
+ * @param shift Pin number minus data bit number.
+ * @param write_factor Power of 2 that moves the data bits to their pins, when
+ * multiplied with. Pins are in the low byte of the product if `shift` isn't
+ * negative, in the high byte otherwise.
+ * @param read_factor Power of 2 that moves the pins to their data bits, when
+ * multiplied with. Data bits are in the high byte of the product if `shift` is
+ * positive, in the low byte otherwise.
+ */
+struct hal_io_bus_segment {
+    uint8_t port_index;
+    uint8_t data_mask;
+    int8_t shift;
+    uint8_t write_factor;
+    uint8_t read_factor;
+};
+
+/**
+ * Parallel bus, up to 8 bits wide, with pins that can be spread across
+ * multiple ports. Should be initialized with hal_io_bus_init().
+ *
+ * @param ports Ports that have bus pins.
+ * @param port_count Number of used `ports`.
+ * @param segments Runs of consecutive pins.
+ * @param segment_count Number of used `segments`.
+ * @param strobe_register PINx register of the strobe pin. `NULL` if there is
+ * no strobe pin.
+ * @param strobe_mask Strobe pin's bit.
+ * @param strobe_width Minimum width of the strobe pulse, in CPU cycles.
+ */
+struct hal_io_bus {
+    struct hal_io_bus_port ports[3];
+    uint8_t port_count;
+    struct hal_io_bus_segment segments[8];
+    uint8_t segment_count;
+    volatile uint8_t *strobe_register;
+    uint8_t strobe_mask;
+    uint8_t strobe_width;
+};
+
+/**
+ * Debounces all pins of a port. Should be initialized with
+ * hal_io_debouncer_init().
+ *
+ * @param pin_register PINx register of the port.
+ * @param active_low_mask Pins that are active when they are low.
+ * @param state Debounced state. A bit is 1 if matching pin is active.
+ * @param counter_0 Lower bits of the vertical counters.
+ * @param counter_1 Higher bits of the vertical counters.
+ * @param pressed Pins that became active since last read.
+ * @param released Pins that became inactive since last read.
+ */
+struct hal_io_debouncer {
+    volatile uint8_t *pin_register;
+    uint8_t active_low_mask;
+    volatile uint8_t state;
+    uint8_t counter_0;
+    uint8_t counter_1;
+    volatile uint8_t pressed;
+    volatile uint8_t released;
+};
+
+// Extras.
+enum hal_result_io hal_io_bus_init(struct hal_io_bus *bus,
+                                   const struct hal_io_pin *pins,
+                                   uint8_t width,
+                                   const struct hal_io_pin *strobe);
+void hal_io_bus_set_strobe_width(struct hal_io_bus *bus, uint8_t cycles);
+void hal_io_bus_set_direction(struct hal_io_bus *bus,
+                              enum hal_io_pin_direction direction);
+void hal_io_bus_write(struct hal_io_bus *bus, uint8_t data);
+uint8_t hal_io_bus_read(struct hal_io_bus *bus);
+enum hal_result_io hal_io_bitstream_write(struct hal_io_pin io,
+                                          const uint8_t *data, uint16_t length);
+enum hal_result_io hal_io_debouncer_init(struct hal_io_debouncer *debouncer,
+                                         enum hal_io_port port,
+                                         uint8_t active_low_mask);
+void hal_io_debouncer_tick(struct hal_io_debouncer *debouncer);
+uint8_t hal_io_debouncer_get_state(struct hal_io_debouncer *debouncer);
+uint8_t hal_io_debouncer_get_pressed(struct hal_io_debouncer *debouncer,
+                                     uint8_t mask);
+uint8_t hal_io_debouncer_get_released(struct hal_io_debouncer *debouncer,
+                                      uint8_t mask);
+
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_configure_checked_(struct hal_io_pin io,
+                          struct hal_io_pin_configuration configuration) {
+    HAL_CHECK_CONSTANT_ARGUMENT(io.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(io.pin < 8);
+    HAL_CHECK_CONSTANT_ARGUMENT(
+        configuration.direction <= hal_io_direction_input);
+    return hal_io_configure(io, configuration);
+}
+#define hal_io_configure hal_io_configure_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_write_checked_(struct hal_io_pin io, enum hal_io_pin_state state) {
+    HAL_CHECK_CONSTANT_ARGUMENT(io.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(io.pin < 8);
+    HAL_CHECK_CONSTANT_ARGUMENT(state <= hal_io_state_high);
+    return hal_io_write(io, state);
+}
+#define hal_io_write hal_io_write_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_toggle_checked_(struct hal_io_pin io) {
+    HAL_CHECK_CONSTANT_ARGUMENT(io.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(io.pin < 8);
+    return hal_io_toggle(io);
+}
+#define hal_io_toggle hal_io_toggle_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_read_checked_(struct hal_io_pin io, enum hal_io_pin_state *state) {
+    HAL_CHECK_CONSTANT_ARGUMENT(io.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(io.pin < 8);
+    return hal_io_read(io, state);
+}
+#define hal_io_read hal_io_read_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_write_port_checked_(enum hal_io_port port, uint8_t value) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_io_write_port(port, value);
+}
+#define hal_io_write_port hal_io_write_port_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_modify_port_checked_(enum hal_io_port port, uint8_t set_mask,
+                            uint8_t clear_mask) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_io_modify_port(port, set_mask, clear_mask);
+}
+#define hal_io_modify_port hal_io_modify_port_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_toggle_port_checked_(enum hal_io_port port, uint8_t mask) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_io_toggle_port(port, mask);
+}
+#define hal_io_toggle_port hal_io_toggle_port_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_read_port_checked_(enum hal_io_port port, uint8_t *value) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_io_read_port(port, value);
+}
+#define hal_io_read_port hal_io_read_port_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_bitstream_write_checked_(struct hal_io_pin io, const uint8_t *data,
+                                uint16_t length) {
+    HAL_CHECK_CONSTANT_ARGUMENT(io.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(io.pin < 8);
+    return hal_io_bitstream_write(io, data, length);
+}
+#define hal_io_bitstream_write hal_io_bitstream_write_checked_
+
+HAL_CHECKED_INLINE enum hal_result_io
+hal_io_debouncer_init_checked_(struct hal_io_debouncer *debouncer,
+                               enum hal_io_port port, uint8_t active_low_mask) {
+    HAL_CHECK_CONSTANT_ARGUMENT(port <= hal_io_port_d);
+    return hal_io_debouncer_init(debouncer, port, active_low_mask);
+}
+#define hal_io_debouncer_init hal_io_debouncer_init_checked_
+#endif // HAL_RELEASE_BUILD
+
+/**
+ * DDRx register of a port.
+ */
+#define HAL_IO_DDR_REGISTER(port) (*(&DDRB + 3 * (uint8_t)(port)))
+
+/**
+ * PORTx register of a port.
+ */
+#define HAL_IO_PORT_REGISTER(port) (*(&PORTB + 3 * (uint8_t)(port)))
+
+/**
+ * PINx register of a port.
+ */
+#define HAL_IO_PIN_REGISTER(port) (*(&PINB + 3 * (uint8_t)(port)))
+
+/**
+ * Breaks the build if given port and pin are not constant or are invalid.
+ */
+#define HAL_IO_CHECK_FAST_PIN(port, pin)                                       \
+    HAL_STATIC_ASSERT((unsigned)(port) <= hal_io_port_d && (unsigned)(pin) < 8)
+
+#define HAL_IO_FAST_PIN_(io_port, io_pin)                                      \
+    ((struct hal_io_pin){                                                      \
+        .port = (io_port) + HAL_IO_CHECK_FAST_PIN(io_port, io_pin),            \
+        .pin = (io_pin)})
+#define HAL_IO_FAST_HIGH_(port, pin)                                           \
+    ((void)HAL_IO_CHECK_FAST_PIN(port, pin),                                   \
+     HAL_IO_PORT_REGISTER(port) |= _BV(pin))
+#define HAL_IO_FAST_LOW_(port, pin)                                            \
+    ((void)HAL_IO_CHECK_FAST_PIN(port, pin),                                   \
+     HAL_IO_PORT_REGISTER(port) &= (uint8_t)~_BV(pin))
+#define HAL_IO_FAST_WRITE_(port, pin, state)                                   \
+    ((state) == hal_io_state_low ? HAL_IO_FAST_LOW_(port, pin)                 \
+                                 : HAL_IO_FAST_HIGH_(port, pin))
+#define HAL_IO_FAST_TOGGLE_(port, pin)                                         \
+    ((void)HAL_IO_CHECK_FAST_PIN(port, pin),                                   \
+     HAL_IO_PIN_REGISTER(port) = _BV(pin))
+#define HAL_IO_FAST_READ_(port, pin)                                           \
+    ((enum hal_io_pin_state)(HAL_IO_CHECK_FAST_PIN(port, pin) +                \
+                             ((HAL_IO_PIN_REGISTER(port) & _BV(pin)) != 0)))
+
+/**
+ * Converts a pin descriptor to a \ref hal_io_pin.
+ */
+#define hal_io_fast_pin(...) HAL_IO_FAST_PIN_(__VA_ARGS__)
+
+/**
+ * Sets a pin high with a single `sbi` instruction.
+ */
+#define hal_io_fast_high(...) HAL_IO_FAST_HIGH_(__VA_ARGS__)
+
+/**
+ * Sets a pin low with a single `cbi` instruction.
+ */
+#define hal_io_fast_low(...) HAL_IO_FAST_LOW_(__VA_ARGS__)
+
+/**
+ * Sets state of a pin. Takes a pin descriptor, followed by a \ref
+ * hal_io_pin_state. If state is constant too, compiles to a single instruction.
+ */
+#define hal_io_fast_write(...) HAL_IO_FAST_WRITE_(__VA_ARGS__)
+
+/**
+ * Toggles a pin by writing a one to it's PINx register. Writing zeros to the
+ * other pins leaves them as they are, unlike a read-modify-write, which would
+ * toggle all of the pins that read high.
+ */
+#define hal_io_fast_toggle(...) HAL_IO_FAST_TOGGLE_(__VA_ARGS__)
+
+/**
+ * Reads a pin. Evaluates to a \ref hal_io_pin_state and compiles to a single
+ * `sbis`/`sbic` instruction when used in a condition.
+ */
+#define hal_io_fast_read(...) HAL_IO_FAST_READ_(__VA_ARGS__)
+
 #endif // __HAL_IO_H
@@ -35,6 +35,8 @@
 #ifndef __HAL_POWER_H
 #define __HAL_POWER_H
 
+#include "hal_checks.h"
+
 #include <stdint.h>
 
 /**
@@ -87,4 +89,32 @@ enum hal_result_power hal_power_set_module_power(enum hal_power_modules module,
 enum hal_result_power hal_power_change_module_powers(uint8_t power_off_list,
                                                      uint8_t power_on_list);
 
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_power
+hal_power_set_sleep_mode_checked_(enum hal_power_sleep_modes mode) {
+    HAL_CHECK_CONSTANT_ARGUMENT(mode <= 7 && mode != 4 && mode != 5);
+    return hal_power_set_sleep_mode(mode);
+}
+#define hal_power_set_sleep_mode hal_power_set_sleep_mode_checked_
+
+HAL_CHECKED_INLINE enum hal_result_power
+hal_power_set_module_power_checked_(enum hal_power_modules module,
+                                    uint8_t state) {
+    HAL_CHECK_CONSTANT_ARGUMENT(module <= 7 && module != 4);
+    return hal_power_set_module_power(module, state);
+}
+#define hal_power_set_module_power hal_power_set_module_power_checked_
+
+HAL_CHECKED_INLINE enum hal_result_power
+hal_power_change_module_powers_checked_(uint8_t power_off_list,
+                                        uint8_t power_on_list) {
+    HAL_CHECK_CONSTANT_ARGUMENT(
+        power_off_list != 1 << 4 && power_on_list != 1 << 4);
+    HAL_CHECK_CONSTANT_ARGUMENT(power_off_list ^ power_on_list);
+    return hal_power_change_module_powers(power_off_list, power_on_list);
+}
+#define hal_power_change_module_powers hal_power_change_module_powers_checked_
+#endif // HAL_RELEASE_BUILD
+
 #endif // __HAL_POWER_H
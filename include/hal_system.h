@@ -37,6 +37,8 @@
 #ifndef __HAL_SYSTEM_H
 #define __HAL_SYSTEM_H
 
+#include "hal_checks.h"
+
 #include <stdint.h>
 
 /// @brief Module specific errors for the power related stuff.
@@ -112,4 +114,17 @@ enum hal_result_system
 hal_system_set_watchdog(struct hal_system_watchdog_t config);
 enum hal_system_reset_status hal_system_get_reset_status();
 
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_system
+hal_system_set_watchdog_checked_(struct hal_system_watchdog_t config) {
+    HAL_CHECK_CONSTANT_ARGUMENT(
+        config.cycles <= hal_system_watchdog_1024k_cycles);
+    HAL_CHECK_CONSTANT_ARGUMENT(
+        config.mode <= hal_system_watchdog_interrupt_and_reset_mode);
+    return hal_system_set_watchdog(config);
+}
+#define hal_system_set_watchdog hal_system_set_watchdog_checked_
+#endif // HAL_RELEASE_BUILD
+
 #endif // __HAL_SYSTEM_H
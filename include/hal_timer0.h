@@ -8,11 +8,148 @@
  *
  * \see hal_power_set_module_power
  * \see hal_power_modules
+ *
+ * ## PWM
+ *
+ * Fast PWM and phase correct PWM modes count either to 0xFF, or to OCR0A.
+ * With OCR0A as the top, frequency can be adjusted, but only OC0B (PD5) can be
+ * used as a PWM output.
+ *
+ * Duty cycle is changed with \ref hal_timer0_set_output_compare_value(),
+ * while the timer runs. In PWM modes, output compare registers are double
+ * buffered by the hardware, so that the new value takes effect at the top or
+ * bottom of the count and the output doesn't glitch.
+ *
+ * Code example:
+ *
+ * ```c
+ * // ~976 Hz at 16 MHz, non-inverted output on OC0A (PD6).
+ * hal_timer0_set_operation_mode(hal_timer0_mode_fast_pwm);
+ * hal_timer0_set_output_compare_mode(hal_timer0_output_compare_register_a,
+ *                                    hal_timer0_compare_output_mode_clear);
+ * hal_timer0_set_output_compare_value(hal_timer0_output_compare_register_a,
+ *                                     64);
+ * hal_timer0_set_clock_source(hal_timer0_prescaler_64);
+ *
+ * // Later, from anywhere.
+ * hal_timer0_set_output_compare_value(hal_timer0_output_compare_register_a,
+ *                                     192);
+ * ```
+ *
+ * In fast PWM mode, a value of 0 still gives a narrow spike every period. Set
+ * the compare output mode to normal for an output that is always off.
+ *
+ * ## Interrupts
+ *
+ * Overflow and output compare interrupts are enabled, disabled or cleared
+ * with hal_timer0_interrupt_enable(), hal_timer0_interrupt_disable() and
+ * hal_timer0_interrupt_clear(). Handlers are bound at compile time, with
+ * macros that expand to an `ISR()`, like the ones of the external interrupts.
+ * A `static inline` handler is inlined in the interrupt service routine, so
+ * there is no indirect call and only the registers that it uses are saved.
+ * With optimizations on, avr-gcc 8 and later also drop the unused saves of
+ * SREG, r0 and r1, so a short handler is as fast as an `ISR_NAKED` one.
+ *
+ * Code example:
+ *
+ * ```c
+ * static inline void on_compare_a(void) { hal_io_fast_toggle(LED); }
+ * HAL_TIMER0_COMPA_ISR(on_compare_a)
+ *
+ * int main() {
+ *     hal_timer0_set_operation_mode(hal_timer0_mode_ctc);
+ *     hal_timer0_set_output_compare_value(
+ *         hal_timer0_output_compare_register_a, 249);
+ *     hal_timer0_interrupt_clear(hal_timer0_interrupt_compare_a);
+ *     hal_timer0_interrupt_enable(hal_timer0_interrupt_compare_a);
+ *     hal_timer0_set_clock_source(hal_timer0_prescaler_64);
+ *     sei();
+ *     ...
+ * }
+ * ```
+ *
+ * ## System Tick
+ *
+ * \ref hal_timer0_tick_init() starts a time base on the timer0 overflow
+ * interrupt, with a prescaler of 64. Then \ref hal_timer0_tick_get_millis()
+ * and \ref hal_timer0_tick_get_micros() can be called from anywhere, including
+ * the interrupts. Timer0 can still be used for PWM, in fast PWM mode with 0xFF
+ * as the top. Other modes don't count 256 times between two overflows, so
+ * the tick is not started in them.
+ *
+ * Code example:
+ *
+ * ```c
+ * uint32_t start;
+ *
+ * hal_timer0_tick_init();
+ * sei();
+ *
+ * start = hal_timer0_tick_get_millis();
+ * while (hal_timer0_tick_get_millis() - start < 500) {
+ *     // Poll something for half a second.
+ * }
+ * ```
+ *
+ * ## Software Timers
+ *
+ * Many timeouts can run on the system tick, with \ref hal_timer0_timer_start().
+ * Timers are statically allocated by the caller, and kept in a timing wheel
+ * of `HAL_TIMER0_WHEEL_SLOTS` overflow periods. Starting and stopping a timer
+ * takes O(1) time. The alarm of the tick, on output compare B, is set for the
+ * next deadline only, so there is no interrupt until a timer expires.
+ *
+ * Code example:
+ *
+ * ```c
+ * static struct hal_timer0_timer blink, retry;
+ *
+ * void on_blink(struct hal_timer0_timer *timer) {
+ *     hal_io_toggle(led);
+ * }
+ *
+ * void on_retry(struct hal_timer0_timer *timer) {
+ *     // Resend the request.
+ * }
+ *
+ * hal_timer0_tick_init();
+ * sei();
+ *
+ * hal_timer0_timer_start(&blink, 500, 500, on_blink);
+ * hal_timer0_timer_start(&retry, 100, 0, on_retry);
+ * // Response is received.
+ * hal_timer0_timer_stop(&retry);
+ * ```
+ *
+ * ## Tickless Idle
+ *
+ * \ref hal_timer0_idle() sleeps until the next software timer. When the
+ * deadline is far enough, and no running peripheral needs the I/O clock, it
+ * stops timer0 in power-down mode and wakes up with the watchdog interrupt.
+ * Then the tick is corrected for the time slept, even if another interrupt
+ * woke the CPU up earlier. So the watchdog interrupt can't be used for
+ * anything else.
+ *
+ * ```c
+ * hal_power_set_module_power(hal_power_adc, 0);
+ * hal_power_set_module_power(hal_power_spi, 0);
+ * hal_power_set_module_power(hal_power_twi, 0);
+ *
+ * while (1) {
+ *     hal_timer0_idle();
+ * }
+ * ```
  * */
 
 // SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
 // SPDX-License-Identifier: MIT
 
+#ifndef __HAL_TIMER0_H
+#define __HAL_TIMER0_H
+
+#include "hal_checks.h"
+
+#include <avr/interrupt.h>
 #include <stdint.h>
 
 /// @brief Available return types for timer0 functions.
@@ -32,6 +169,8 @@ enum hal_result_timer0 {
                                                       ///< output
     hal_result_timer0_invalid_clock_source, ///< An invalid clock source is
                                             ///< specified
+    hal_result_timer0_invalid_interrupt,    ///< An invalid interrupt is
+                                            ///< specified
 };
 
 /// @brief Two of the output compare registers, that are available to timer0.
@@ -40,6 +179,18 @@ enum hal_timer0_output_compare_register {
     hal_timer0_output_compare_register_b = 1  ///< Output compare register B
 };
 
+/**
+ * @brief Interrupts of timer0.
+ *
+ * Enum values matches register bits for that interrupt, both in TIMSK0 and
+ * TIFR0.
+ * */
+enum hal_timer0_interrupt {
+    hal_timer0_interrupt_overflow = 0,  ///< Counter overflow
+    hal_timer0_interrupt_compare_a = 1, ///< Output compare A match
+    hal_timer0_interrupt_compare_b = 2  ///< Output compare B match
+};
+
 /// @brief Define operation mode with output compare bit. Works for non-PWM,
 /// fast PWM or phase correct modes.
 enum hal_timer0_output_compare_mode {
@@ -52,10 +203,36 @@ enum hal_timer0_output_compare_mode {
 
 /// @brief Possible operation modes of the timer0 module.
 enum hal_timer0_operation_modes {
-    hal_timer0_mode_normal = 0,        ///< Counts to the top (0xFF)
-    hal_timer0_mode_ctc,               ///< Counts to the OCR0A
-    hal_timer0_mode_fast_pwm,          ///< High frequency PWM
-    hal_timer0_mode_phase_correct_pwm, ///< High resolution PWM
+    hal_timer0_mode_normal = 0,                  ///< Counts to the top (0xFF)
+    hal_timer0_mode_ctc,                         ///< Counts to the OCR0A
+    hal_timer0_mode_fast_pwm,                    ///< High frequency PWM, top is
+                                                 ///< 0xFF
+    hal_timer0_mode_phase_correct_pwm,           ///< High resolution PWM, top
+                                                 ///< is 0xFF
+    hal_timer0_mode_fast_pwm_ocr0a_top,          ///< High frequency PWM, top is
+                                                 ///< OCR0A
+    hal_timer0_mode_phase_correct_pwm_ocr0a_top, ///< High resolution PWM, top
+                                                 ///< is OCR0A
+};
+
+/**
+ * Number of slots in the timing wheel of the software timers. Each slot is an
+ * overflow period of timer0. Should be a power of 2, between 2 and 32.
+ */
+#ifndef HAL_TIMER0_WHEEL_SLOTS
+#define HAL_TIMER0_WHEEL_SLOTS 16
+#endif // HAL_TIMER0_WHEEL_SLOTS
+
+/**
+ * A software timer. Members are set by \ref hal_timer0_timer_start(), and
+ * shouldn't be changed while it runs.
+ */
+struct hal_timer0_timer {
+    struct hal_timer0_timer *next; ///< Next timer in the same slot
+    struct hal_timer0_timer *prev; ///< Previous timer in the same slot
+    uint32_t deadline;             ///< Expiry time, in timer0 counts
+    uint32_t period;               ///< Period in timer0 counts, 0 if one-shot
+    void (*callback)(struct hal_timer0_timer *timer); ///< NULL if stopped
 };
 
 /// @brief Possible clock sources of the timer0.
@@ -80,4 +257,110 @@ enum hal_result_timer0
 hal_timer0_set_output_compare_mode(enum hal_timer0_output_compare_register reg,
                                    enum hal_timer0_output_compare_mode mode);
 enum hal_result_timer0
+hal_timer0_set_output_compare_value(enum hal_timer0_output_compare_register reg,
+                                    uint8_t value);
+enum hal_result_timer0
 hal_timer0_set_clock_source(enum hal_timer0_clock_source source);
+enum hal_result_timer0
+hal_timer0_interrupt_enable(enum hal_timer0_interrupt interrupt);
+enum hal_result_timer0
+hal_timer0_interrupt_disable(enum hal_timer0_interrupt interrupt);
+enum hal_result_timer0
+hal_timer0_interrupt_clear(enum hal_timer0_interrupt interrupt);
+
+// Interrupt driven functions.
+enum hal_result_timer0 hal_timer0_tick_init();
+uint32_t hal_timer0_tick_get_millis();
+uint32_t hal_timer0_tick_get_micros();
+uint32_t hal_timer0_tick_get_counts();
+enum hal_result_timer0 hal_timer0_tick_set_alarm(uint32_t counts,
+                                                 void (*handler)(void));
+void hal_timer0_tick_cancel_alarm();
+uint8_t hal_timer0_tick_get_alarm(uint32_t *counts);
+void hal_timer0_tick_advance(uint32_t counts);
+
+// Extras.
+void hal_timer0_timer_start(struct hal_timer0_timer *timer, uint16_t delay_ms,
+                            uint16_t period_ms,
+                            void (*callback)(struct hal_timer0_timer *timer));
+void hal_timer0_timer_stop(struct hal_timer0_timer *timer);
+uint8_t hal_timer0_timer_is_running(struct hal_timer0_timer *timer);
+void hal_timer0_idle();
+
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_set_operation_mode_checked_(enum hal_timer0_operation_modes mode) {
+    HAL_CHECK_CONSTANT_ARGUMENT(mode <=
+                                hal_timer0_mode_phase_correct_pwm_ocr0a_top);
+    return hal_timer0_set_operation_mode(mode);
+}
+#define hal_timer0_set_operation_mode hal_timer0_set_operation_mode_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_set_output_compare_mode_checked_(
+    enum hal_timer0_output_compare_register reg,
+    enum hal_timer0_output_compare_mode mode) {
+    HAL_CHECK_CONSTANT_ARGUMENT(reg <= hal_timer0_output_compare_register_b);
+    HAL_CHECK_CONSTANT_ARGUMENT(mode <= hal_timer0_compare_output_mode_set);
+    return hal_timer0_set_output_compare_mode(reg, mode);
+}
+#define hal_timer0_set_output_compare_mode                                     \
+    hal_timer0_set_output_compare_mode_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_set_output_compare_value_checked_(
+    enum hal_timer0_output_compare_register reg, uint8_t value) {
+    HAL_CHECK_CONSTANT_ARGUMENT(reg <= hal_timer0_output_compare_register_b);
+    return hal_timer0_set_output_compare_value(reg, value);
+}
+#define hal_timer0_set_output_compare_value                                    \
+    hal_timer0_set_output_compare_value_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_set_clock_source_checked_(enum hal_timer0_clock_source source) {
+    HAL_CHECK_CONSTANT_ARGUMENT(source <= hal_timer0_external_rising_edge);
+    return hal_timer0_set_clock_source(source);
+}
+#define hal_timer0_set_clock_source hal_timer0_set_clock_source_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_interrupt_enable_checked_(enum hal_timer0_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_timer0_interrupt_compare_b);
+    return hal_timer0_interrupt_enable(interrupt);
+}
+#define hal_timer0_interrupt_enable hal_timer0_interrupt_enable_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_interrupt_disable_checked_(enum hal_timer0_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_timer0_interrupt_compare_b);
+    return hal_timer0_interrupt_disable(interrupt);
+}
+#define hal_timer0_interrupt_disable hal_timer0_interrupt_disable_checked_
+
+HAL_CHECKED_INLINE enum hal_result_timer0
+hal_timer0_interrupt_clear_checked_(enum hal_timer0_interrupt interrupt) {
+    HAL_CHECK_CONSTANT_ARGUMENT(interrupt <= hal_timer0_interrupt_compare_b);
+    return hal_timer0_interrupt_clear(interrupt);
+}
+#define hal_timer0_interrupt_clear hal_timer0_interrupt_clear_checked_
+#endif // HAL_RELEASE_BUILD
+
+/**
+ * Binds `void handler(void)` to the timer0 overflow interrupt. Can't be used
+ * with the system tick, which has its own.
+ */
+#define HAL_TIMER0_OVF_ISR(handler) ISR(TIMER0_OVF_vect) { handler(); }
+
+/**
+ * Binds `void handler(void)` to the timer0 output compare A interrupt.
+ */
+#define HAL_TIMER0_COMPA_ISR(handler) ISR(TIMER0_COMPA_vect) { handler(); }
+
+/**
+ * Binds `void handler(void)` to the timer0 output compare B interrupt. Can't
+ * be used with the system tick, which has its own for the alarm.
+ */
+#define HAL_TIMER0_COMPB_ISR(handler) ISR(TIMER0_COMPB_vect) { handler(); }
+
+#endif // __HAL_TIMER0_H
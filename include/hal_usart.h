@@ -24,6 +24,47 @@
  * result = usart_init(&usart);
  * ```
  *
+ * ## Compile-time Baud Rate
+ *
+ * \ref usart_init() calculates the baud rate register at run-time, with a 32
+ * bit division. If the baud rate is known at compile time,
+ * \ref USART_SET_BAUD_RATE() can be called after the initialization instead.
+ * It selects normal or double speed mode, whichever is more accurate, and the
+ * build fails if the baud rate error is more than `USART_BAUD_TOLERANCE`.
+ * Only asynchronous modes are supported. `F_CPU` should be defined.
+ *
+ * Code example:
+ *
+ * ```c
+ * usart.baud_rate = 0; // Baud rate registers are left as is.
+ * result = usart_init(&usart);
+ * USART_SET_BAUD_RATE(57600);
+ * ```
+ *
+ * Some of the baud rates can't be generated accurately from some of the clock
+ * frequencies, like 115200 from 16 MHz (2.1% error). Either the tolerance can
+ * be increased, or a crystal, like 14.7456 MHz, that can generate them
+ * accurately can be used.
+ *
+ * ## Automatic Baud Rate
+ *
+ * If the baud rate of the other side is not known, it can be detected with
+ * \ref usart_detect_baud_rate(), after the initialization. The other side
+ * should send a sync byte, 0x55 (`'U'`), which sets the baud rate registers.
+ * Timer1 is used for the measurement, and restored afterwards.
+ *
+ * Code example:
+ *
+ * ```c
+ * uint32_t baud_rate;
+ *
+ * usart.baud_rate = 0;
+ * usart_init(&usart);
+ * if (usart_detect_baud_rate(1000, &baud_rate) != usart_success) {
+ *     // No sync byte in a second.
+ * }
+ * ```
+ *
  * ## Sending Data Over USART
  *
  * After initializing USART, data can be sent with \ref usart_transmit()
@@ -35,6 +76,216 @@
  * uint8_t data[] = "Hello, world!\r\n";
  * result = usart_transmit(&usart, data, sizeof data);
  * ```
+ *
+ * ## Receiving With a Timeout
+ *
+ * \ref usart_receive() blocks until all of the bytes are received. Instead,
+ * \ref usart_receive_timeout() gives up after a total timeout, or after a
+ * timeout between 2 bytes, and returns the number of bytes received until
+ * then. Timeouts are in milliseconds, measured with the timer0 system tick,
+ * which should be running. See \ref hal_timer0_tick_init(). So using it links
+ * the timer0 tick interrupts, other USART functions don't.
+ *
+ * Code example:
+ *
+ * ```c
+ * uint8_t response[8];
+ * uint16_t received;
+ *
+ * hal_timer0_tick_init();
+ * sei();
+ *
+ * // Give up after 100 ms in total, or 5 ms between 2 bytes.
+ * result = usart_receive_timeout(response, sizeof response, &received, 100,
+ *                                5);
+ * ```
+ *
+ * ## Sending Multiple Segments
+ *
+ * A frame can be sent from separate buffers without assembling it first, with
+ * \ref usart_transmit_segments(). Each segment can be either in RAM or in
+ * program memory, so that constant strings don't need to be copied to RAM.
+ * Single buffers in program memory can be sent with \ref usart_transmit_P().
+ *
+ * Code example:
+ *
+ * ```c
+ * static const uint8_t header[] PROGMEM = "DATA:";
+ * uint8_t payload[16];
+ * uint16_t crc;
+ *
+ * struct usart_segment segments[] = {
+ *     {header, sizeof header - 1, 1},
+ *     {payload, sizeof payload, 0},
+ *     {(const uint8_t *)&crc, sizeof crc, 0},
+ * };
+ *
+ * result = usart_transmit_segments(segments, 3);
+ * ```
+ *
+ * ## SPI Master Mode
+ *
+ * USART can be used as a second SPI master, with \ref usart_spi_init(). Clock
+ * is output on XCK0 (PD4), data on TXD0 (PD1) and input is read from RXD0
+ * (PD0). Transfers are full duplex, with \ref usart_spi_transfer(). Transmit
+ * is double buffered, so that bytes are sent back to back, up to F_CPU / 2.
+ *
+ * Code example:
+ *
+ * ```c
+ * struct usart_spi_t spi = {
+ *     .clock_rate = 8000000,
+ *     .mode = usart_spi_mode_0,
+ *     .is_lsb_first = 0,
+ * };
+ * uint8_t command[4] = {0x03, 0x00, 0x10, 0x00}, response[4];
+ *
+ * usart_spi_init(&spi);
+ *
+ * hal_io_write(chip_select, hal_io_state_low);
+ * usart_spi_transfer(command, response, sizeof command);
+ * hal_io_write(chip_select, hal_io_state_high);
+ * ```
+ *
+ * ## Interrupt Driven Transmit
+ *
+ * \ref usart_transmit() waits for each byte to be sent. Instead,
+ * \ref usart_transmit_irq() copies data to a buffer and returns immediately.
+ * Buffer is sent from the data register empty interrupt, so global interrupts
+ * should be enabled. Buffer size is set with `USART_TX_BUFFER_SIZE` while
+ * compiling the library.
+ *
+ * Code example:
+ *
+ * ```c
+ * uint8_t frame[32];
+ *
+ * if (usart_transmit_irq_free() >= sizeof frame) {
+ *     usart_transmit_irq(frame, sizeof frame);
+ * }
+ *
+ * // Segments are queued as a whole, or not at all.
+ * usart_transmit_irq_segments(segments, 3);
+ *
+ * // Before sleeping, make sure that everything is sent.
+ * usart_transmit_irq_flush();
+ * ```
+ *
+ * ## RS-485
+ *
+ * For a half duplex RS-485 transceiver, \ref usart_rs485_enable() takes its
+ * driver enable (DE) pin. Interrupt driven transmit functions drive it high
+ * before the first byte, and the transmit complete interrupt drives it low
+ * right after the last stop bit. Blocking transmit functions don't drive it.
+ *
+ * Code example:
+ *
+ * ```c
+ * static const struct hal_io_pin driver_enable = {hal_io_port_d, 2};
+ *
+ * usart_rs485_enable(driver_enable);
+ * usart_transmit_irq(request, sizeof request);
+ * // Bus is released by the interrupt, while the response is awaited.
+ * ```
+ *
+ * ## Interrupt Driven Receive
+ *
+ * After \ref usart_receive_irq_enable(), received bytes are moved to a buffer
+ * from the receive complete interrupt. Its size is set with
+ * `USART_RX_BUFFER_SIZE`. Bytes with framing or parity errors are dropped, and
+ * all of the errors are counted. Counters can be read with
+ * \ref usart_receive_irq_get_errors().
+ *
+ * Code example:
+ *
+ * ```c
+ * uint8_t command[16], len;
+ * struct usart_errors errors;
+ *
+ * usart_receive_irq_enable();
+ *
+ * while (1) {
+ *     len = usart_receive_irq_read_bulk(command, sizeof command);
+ *
+ *     usart_receive_irq_get_errors(&errors);
+ *     if (errors.buffer_overrun) {
+ *         // Read more frequently or increase the buffer size.
+ *     }
+ * }
+ * ```
+ *
+ * ## Multi-processor Communication Mode
+ *
+ * On a multi-drop bus, a node can be selected with an address frame, which has
+ * the 9th bit set, by \ref usart_transmit_irq_address(). It's queued with the
+ * interrupt driven transmit, so it's sent in order and in RS-485 mode, the bus
+ * is taken for it too. Data frames that follow it are for that node only. With \ref usart_receive_irq_set_address(), a
+ * node receives only the data frames addressed to it. Others are ignored by
+ * hardware, without an interrupt. USART should be initialized with 9 data bits
+ * on all of the nodes.
+ *
+ * Code example:
+ *
+ * ```c
+ * // Main node.
+ * usart_transmit_irq_address(0x12);
+ * usart_transmit_irq(command, sizeof command);
+ *
+ * // Node 0x12.
+ * usart_receive_irq_set_address(0x12);
+ * usart_receive_irq_enable();
+ * ```
+ *
+ * ## Formatted Output
+ *
+ * `printf()` pulls `vfprintf()` of avr-libc in, which takes a few kilobytes
+ * of flash. For debug output, numbers can be formatted with
+ * \ref usart_format_uint(), \ref usart_format_int(),
+ * \ref usart_format_hex() and \ref usart_format_fixed() instead. They don't
+ * divide, and write into a buffer of `USART_FORMAT_BUFFER_SIZE` chars.
+ *
+ * Standard output can be buffered with \ref usart_stdio_init_buffered(), so
+ * that it is queued to the interrupt driven transmitter, instead of waiting
+ * for each char. Chars that don't fit into the buffer are dropped.
+ * \ref usart_stdio_flush() waits until it is transmitted.
+ *
+ * Code example:
+ *
+ * ```c
+ * char buffer[USART_FORMAT_BUFFER_SIZE];
+ * uint8_t length;
+ *
+ * usart_transmit_irq((const uint8_t *)"T=", 2);
+ * length = usart_format_fixed(buffer, temperature_centi, 2);
+ * usart_transmit_irq((const uint8_t *)buffer, length);
+ * ```
+ *
+ * ## Receiving Frames
+ *
+ * Instead of the receive buffer, received bytes can be decoded into frames in
+ * the receive complete interrupt, with \ref usart_receive_irq_set_framing().
+ * COBS and SLIP framings are supported. Each frame should end with its
+ * CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF), in big endian. CRC
+ * is updated while bytes are received, and corrupt frames are dropped before
+ * reaching the application.
+ *
+ * Code example:
+ *
+ * ```c
+ * static uint8_t frame_a[64], frame_b[64];
+ * const uint8_t *frame;
+ * uint8_t length;
+ *
+ * usart_receive_irq_set_framing(usart_framing_cobs, frame_a, frame_b, 64);
+ * usart_receive_irq_enable();
+ *
+ * while (1) {
+ *     if (usart_receive_irq_get_frame(&frame, &length) == usart_success) {
+ *         handle_frame(frame, length);
+ *         usart_receive_irq_release_frame();
+ *     }
+ * }
+ * ```
  * */
 
 // SPDX-FileCopyrightText: 2023 Ceyhun Şen <ceyhuusen@gmail.com>
@@ -43,8 +294,105 @@
 #ifndef __HAL_USART_H
 #define __HAL_USART_H
 
+#include "hal_checks.h"
+#include "hal_io.h"
+
+#include <avr/io.h>
 #include <stdint.h>
 
+/**
+ * Transmit buffer size of the interrupt driven USART functions. Should be a
+ * power of 2, between 2 and 128.
+ */
+#ifndef USART_TX_BUFFER_SIZE
+#define USART_TX_BUFFER_SIZE 64
+#endif // USART_TX_BUFFER_SIZE
+
+/**
+ * Receive buffer size of the interrupt driven USART functions. Should be a
+ * power of 2, between 2 and 128.
+ */
+#ifndef USART_RX_BUFFER_SIZE
+#define USART_RX_BUFFER_SIZE 64
+#endif // USART_RX_BUFFER_SIZE
+
+/**
+ * Buffer size for the formatting functions, enough for a sign, 10 digits, a
+ * decimal point and the null terminator.
+ */
+#define USART_FORMAT_BUFFER_SIZE 13
+
+/**
+ * Maximum baud rate error allowed by \ref USART_SET_BAUD_RATE(), in 0.1%
+ * units. Default is 2%.
+ */
+#ifndef USART_BAUD_TOLERANCE
+#define USART_BAUD_TOLERANCE 20
+#endif // USART_BAUD_TOLERANCE
+
+/**
+ * Clock cycles per bit, for a baud rate register of 0.
+ */
+#define USART_BAUD_CYCLES_(baud, divisor)                                      \
+    ((unsigned long long)(divisor) * (baud))
+
+/**
+ * Rounded baud rate register value.
+ */
+#define USART_UBRR_(baud, divisor)                                             \
+    ((F_CPU + USART_BAUD_CYCLES_(baud, divisor) / 2) /                         \
+         USART_BAUD_CYCLES_(baud, divisor) -                                   \
+     1)
+
+/**
+ * Baud rate error, in 0.1% units.
+ */
+#define USART_BAUD_ERROR_(baud, divisor)                                       \
+    USART_BAUD_ERROR_CYCLES_(                                                  \
+        USART_BAUD_CYCLES_(baud, divisor) * (USART_UBRR_(baud, divisor) + 1))
+#define USART_BAUD_ERROR_CYCLES_(cycles)                                       \
+    (((cycles) > F_CPU ? (cycles) - F_CPU : F_CPU - (cycles)) * 1000 / (cycles))
+
+/**
+ * 1 if double speed mode is more accurate for `baud`, 0 otherwise. Normal mode
+ * is preferred on a tie, as its receiver is more tolerant.
+ */
+#define USART_USE_2X(baud)                                                     \
+    (USART_BAUD_ERROR_(baud, 8) < USART_BAUD_ERROR_(baud, 16))
+
+/**
+ * Baud rate register value for `baud`, in the mode selected by
+ * \ref USART_USE_2X().
+ */
+#define USART_UBRR_VALUE(baud)                                                 \
+    (USART_USE_2X(baud) ? USART_UBRR_(baud, 8) : USART_UBRR_(baud, 16))
+
+/**
+ * Baud rate error for `baud`, in 0.1% units, in the mode selected by
+ * \ref USART_USE_2X().
+ */
+#define USART_BAUD_ERROR(baud)                                                 \
+    (USART_USE_2X(baud) ? USART_BAUD_ERROR_(baud, 8)                           \
+                        : USART_BAUD_ERROR_(baud, 16))
+
+/**
+ * Set baud rate registers and double speed mode for a constant `baud`. Breaks
+ * the build if baud rate can't be generated within `USART_BAUD_TOLERANCE`.
+ *
+ * Transmit complete flag is cleared by writing 1 to it, so UCSR0A is written
+ * with only the control bits, instead of a read-modify-write.
+ */
+#define USART_SET_BAUD_RATE(baud)                                              \
+    do {                                                                       \
+        (void)HAL_STATIC_ASSERT(USART_UBRR_VALUE(baud) <= 0x0FFF &&            \
+                                USART_BAUD_ERROR(baud) <=                      \
+                                    USART_BAUD_TOLERANCE);                     \
+        UBRR0H = (uint8_t)(USART_UBRR_VALUE(baud) >> 8);                       \
+        UBRR0L = (uint8_t)USART_UBRR_VALUE(baud);                              \
+        UCSR0A = (UCSR0A & _BV(MPCM0)) |                                       \
+                 (USART_USE_2X(baud) ? _BV(U2X0) : 0);                         \
+    } while (0)
+
 /**
  * Return results for USART module.
  */
@@ -55,6 +403,7 @@ enum usart_result {
     usart_error_underrun,
     usart_error_framing,
     usart_error_parity,
+    usart_error_timeout,
 };
 
 /**
@@ -87,7 +436,8 @@ enum usart_parity {
 /**
  * USART data struct.
  *
- * @param baud_rate
+ * @param baud_rate 0 to leave baud rate registers as is, for
+ * \ref USART_SET_BAUD_RATE(). Or
  * * 2400
  * * 4800
  * * 9600
@@ -121,14 +471,154 @@ struct usart_t {
     enum usart_parity parity;
 };
 
+/**
+ * Framing of the received bytes, for the interrupt driven USART functions.
+ * */
+enum usart_framing {
+    usart_framing_none, ///< Bytes are moved to the receive buffer.
+    usart_framing_cobs, ///< Consistent overhead byte stuffing, 0x00 delimited.
+    usart_framing_slip, ///< Serial line internet protocol, 0xC0 delimited.
+};
+
+/**
+ * Receive error counters of the interrupt driven USART functions.
+ * */
+struct usart_errors {
+    uint8_t overrun;        ///< Bytes lost, before the receive interrupt ran.
+    uint8_t framing;        ///< Bytes dropped with a framing error.
+    uint8_t parity;         ///< Bytes dropped with a parity error.
+    uint8_t buffer_overrun; ///< Bytes or frames dropped, as the buffers were
+                            ///< full.
+    uint8_t frame;          ///< Frames dropped, as they were corrupt, too long
+                            ///< or had a wrong CRC.
+};
+
+/**
+ * A segment of data to be transmitted, from RAM or program memory.
+ * */
+struct usart_segment {
+    const uint8_t *data; ///< Start of the segment.
+    uint16_t len;        ///< Segment length.
+    uint8_t is_progmem;  ///< 1 if `data` is in program memory (`PROGMEM`).
+};
+
+/**
+ * Clock polarity and phase in SPI master mode.
+ * */
+enum usart_spi_mode {
+    usart_spi_mode_0, ///< Idle low, sample on the rising edge.
+    usart_spi_mode_1, ///< Idle low, sample on the falling edge.
+    usart_spi_mode_2, ///< Idle high, sample on the falling edge.
+    usart_spi_mode_3, ///< Idle high, sample on the rising edge.
+};
+
+/**
+ * USART settings for SPI master mode.
+ * */
+struct usart_spi_t {
+    uint32_t clock_rate;      ///< Maximum clock rate in Hz, up to F_CPU / 2.
+    enum usart_spi_mode mode; ///< Clock polarity and phase.
+    uint8_t is_lsb_first;     ///< 1 to shift least significant bit first.
+};
+
 // Core functions.
 enum usart_result usart_init(struct usart_t *usart);
 enum usart_result usart_transmit(struct usart_t *usart, uint8_t *data,
                                  uint16_t len);
 enum usart_result usart_receive(struct usart_t *usart, uint8_t *data,
                                 uint16_t len);
+enum usart_result usart_receive_timeout(uint8_t *data, uint16_t len,
+                                        uint16_t *received,
+                                        uint16_t timeout_ms,
+                                        uint16_t byte_timeout_ms);
+enum usart_result usart_transmit_P(const uint8_t *data, uint16_t len);
+enum usart_result usart_detect_baud_rate(uint16_t timeout_ms,
+                                         uint32_t *baud_rate);
+enum usart_result usart_spi_init(struct usart_spi_t *spi);
+enum usart_result usart_spi_transfer(const uint8_t *tx, uint8_t *rx,
+                                     uint16_t len);
+enum usart_result usart_transmit_segments(const struct usart_segment *segments,
+                                          uint8_t count);
+
+// Interrupt driven functions.
+uint16_t usart_transmit_irq(const uint8_t *data, uint16_t len);
+uint8_t usart_transmit_irq_free();
+enum usart_result
+usart_transmit_irq_segments(const struct usart_segment *segments,
+                            uint8_t count);
+void usart_transmit_irq_flush();
+enum usart_result usart_transmit_irq_address(uint8_t address);
+enum usart_result usart_rs485_enable(struct hal_io_pin driver_enable);
+void usart_rs485_disable();
+void usart_receive_irq_enable();
+void usart_receive_irq_disable();
+uint8_t usart_receive_irq_available();
+enum usart_result usart_receive_irq_read(uint8_t *data);
+uint8_t usart_receive_irq_read_bulk(uint8_t *data, uint8_t len);
+void usart_receive_irq_get_errors(struct usart_errors *errors);
+void usart_receive_irq_set_address(uint8_t address);
+void usart_receive_irq_clear_address();
+void usart_receive_irq_set_framing(enum usart_framing framing,
+                                   uint8_t *buffer_a, uint8_t *buffer_b,
+                                   uint8_t size);
+enum usart_result usart_receive_irq_get_frame(const uint8_t **frame,
+                                              uint8_t *length);
+void usart_receive_irq_release_frame();
 
 // Extras.
 void usart_stdio_init();
+void usart_stdio_init_buffered();
+void usart_stdio_flush();
+void usart_stdio_set_timeout(uint16_t timeout_ms);
+
+// Formatting.
+uint8_t usart_format_uint(char *buffer, uint32_t value);
+uint8_t usart_format_int(char *buffer, int32_t value);
+uint8_t usart_format_hex(char *buffer, uint32_t value, uint8_t digits);
+uint8_t usart_format_fixed(char *buffer, int32_t value,
+                           uint8_t fraction_digits);
+
+#if defined(HAL_RELEASE_BUILD)
+// Compile-time checks of constant arguments, see hal_checks.h.
+HAL_CHECKED_INLINE enum usart_result
+usart_init_checked_(struct usart_t *usart) {
+    HAL_CHECK_CONSTANT_ARGUMENT(usart->data_bits >= 5 &&
+                                usart->data_bits <= 9);
+    HAL_CHECK_CONSTANT_ARGUMENT(usart->stop_bits <= 2);
+    return usart_init(usart);
+}
+#define usart_init usart_init_checked_
+
+HAL_CHECKED_INLINE enum usart_result
+usart_rs485_enable_checked_(struct hal_io_pin driver_enable) {
+    HAL_CHECK_CONSTANT_ARGUMENT(driver_enable.port <= hal_io_port_d);
+    HAL_CHECK_CONSTANT_ARGUMENT(driver_enable.pin < 8);
+    return usart_rs485_enable(driver_enable);
+}
+#define usart_rs485_enable usart_rs485_enable_checked_
+
+HAL_CHECKED_INLINE enum usart_result
+usart_spi_init_checked_(struct usart_spi_t *spi) {
+    HAL_CHECK_CONSTANT_ARGUMENT(spi->clock_rate != 0);
+    HAL_CHECK_CONSTANT_ARGUMENT(spi->mode <= usart_spi_mode_3);
+    return usart_spi_init(spi);
+}
+#define usart_spi_init usart_spi_init_checked_
+
+HAL_CHECKED_INLINE uint8_t usart_format_hex_checked_(char *buffer,
+                                                     uint32_t value,
+                                                     uint8_t digits) {
+    HAL_CHECK_CONSTANT_ARGUMENT(digits >= 1 && digits <= 8);
+    return usart_format_hex(buffer, value, digits);
+}
+#define usart_format_hex usart_format_hex_checked_
+
+HAL_CHECKED_INLINE uint8_t usart_format_fixed_checked_(
+    char *buffer, int32_t value, uint8_t fraction_digits) {
+    HAL_CHECK_CONSTANT_ARGUMENT(fraction_digits <= 9);
+    return usart_format_fixed(buffer, value, fraction_digits);
+}
+#define usart_format_fixed usart_format_fixed_checked_
+#endif // HAL_RELEASE_BUILD
 
 #endif // __HAL_USART_H
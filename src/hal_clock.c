@@ -9,10 +9,14 @@
 // SPDX-License-Identifier: MIT
 
 #include "hal_clock.h"
+#include "hal_internals.h"
 
 #include <avr/io.h>
 #include <avr/sfr_defs.h>
 
+// Checking wrappers of the header are for the callers only.
+#undef hal_clock_change_clock_prescaler
+
 /**
  * @brief Returns current oscillator calibration value.
  * @returns Parsed calibration value with range.
@@ -52,9 +56,8 @@ enum hal_clock_prescaler_division_rates hal_clock_get_clock_prescaler() {
  */
 enum hal_result_clock hal_clock_change_clock_prescaler(
     enum hal_clock_prescaler_division_rates divisor) {
-    if (divisor > hal_clock_prescaler_256) {
-        return hal_result_clock_invalid_prescaler;
-    }
+    CHECK_ARGUMENT(divisor > hal_clock_prescaler_256,
+                   hal_result_clock_invalid_prescaler);
 
     // Enable prescaler.
     CLKPR = 1 << 7;
@@ -0,0 +1,158 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ *
+ * @brief External interrupts module, main functionalities.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_exint.h"
+#include "hal_internals.h"
+
+#include <avr/io.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef hal_exint_configure
+#undef hal_exint_enable
+#undef hal_exint_disable
+#undef hal_exint_clear
+#undef hal_exint_pin_change_enable
+#undef hal_exint_pin_change_disable
+
+volatile uint8_t hal_exint_pin_snapshots[3];
+
+/**
+ * Checks if external interrupt is valid. If not, returns error.
+ */
+#define CHECK_EXINT_INTERRUPT(interrupt)                                       \
+    CHECK_ARGUMENT(interrupt > hal_exint_int1,                                 \
+                   hal_result_exint_invalid_interrupt)
+
+/**
+ * Checks if port is valid. If not, returns error.
+ */
+#define CHECK_EXINT_PORT(port)                                                 \
+    CHECK_ARGUMENT(port > hal_io_port_d, hal_result_exint_invalid_port)
+
+/**
+ * @brief Set which signal triggers an external interrupt.
+ *
+ * Changing the sense control might trigger an interrupt, so it should be done
+ * while the interrupt is disabled. And interrupt flag should be cleared with
+ * hal_exint_clear() before enabling it.
+ *
+ * @param interrupt Target interrupt.
+ * @param sense New sense control.
+ *
+ * @returns Error if given interrupt or sense control is invalid.
+ */
+enum hal_result_exint hal_exint_configure(enum hal_exint_interrupt interrupt,
+                                          enum hal_exint_sense sense) {
+    uint8_t shift, reg;
+
+    CHECK_EXINT_INTERRUPT(interrupt);
+    CHECK_ARGUMENT(sense > hal_exint_sense_rising_edge,
+                   hal_result_exint_invalid_sense);
+
+    // Each interrupt has 2 sense control bits.
+    shift = interrupt == hal_exint_int0 ? ISC00 : ISC10;
+
+    reg = EICRA;
+    reg &= ~(0b11 << shift);
+    reg |= sense << shift;
+    EICRA = reg;
+
+    return hal_result_exint_ok;
+}
+
+/**
+ * @brief Enable an external interrupt. Global interrupts should be enabled too.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_exint hal_exint_enable(enum hal_exint_interrupt interrupt) {
+    CHECK_EXINT_INTERRUPT(interrupt);
+
+    SET_BIT(EIMSK, interrupt);
+
+    return hal_result_exint_ok;
+}
+
+/**
+ * @brief Disable an external interrupt.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_exint hal_exint_disable(enum hal_exint_interrupt interrupt) {
+    CHECK_EXINT_INTERRUPT(interrupt);
+
+    CLEAR_BIT(EIMSK, interrupt);
+
+    return hal_result_exint_ok;
+}
+
+/**
+ * @brief Clear pending flag of an external interrupt.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_exint hal_exint_clear(enum hal_exint_interrupt interrupt) {
+    CHECK_EXINT_INTERRUPT(interrupt);
+
+    // Flag is cleared by writing 1 to it.
+    EIFR = BIT(interrupt);
+
+    return hal_result_exint_ok;
+}
+
+/**
+ * @brief Enable pin change interrupts for the given pins of a port. Other pins
+ * of the port won't trigger an interrupt.
+ *
+ * Current pin states are saved, so that the first interrupt will only report
+ * changes after this call.
+ *
+ * @param port Target port.
+ * @param mask Pins that will trigger an interrupt.
+ *
+ * @returns Error if given port is invalid.
+ */
+enum hal_result_exint hal_exint_pin_change_enable(enum hal_io_port port,
+                                                  uint8_t mask) {
+    CHECK_EXINT_PORT(port);
+
+    CLEAR_BIT(PCICR, port);
+
+    HAL_EXINT_PCMSK_REGISTER(port) = mask;
+    hal_exint_pin_snapshots[port] = HAL_IO_PIN_REGISTER(port);
+
+    // Flag is cleared by writing 1 to it.
+    PCIFR = BIT(port);
+    SET_BIT(PCICR, port);
+
+    return hal_result_exint_ok;
+}
+
+/**
+ * @brief Disable pin change interrupts of a port.
+ *
+ * @param port Target port.
+ *
+ * @returns Error if given port is invalid.
+ */
+enum hal_result_exint hal_exint_pin_change_disable(enum hal_io_port port) {
+    CHECK_EXINT_PORT(port);
+
+    CLEAR_BIT(PCICR, port);
+    HAL_EXINT_PCMSK_REGISTER(port) = 0;
+
+    return hal_result_exint_ok;
+}
@@ -12,37 +12,50 @@
 #include "hal_internals.h"
 
 #include <avr/io.h>
-
+#include <avr/pgmspace.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef hal_io_configure
+#undef hal_io_write
+#undef hal_io_toggle
+#undef hal_io_read
+#undef hal_io_write_port
+#undef hal_io_modify_port
+#undef hal_io_toggle_port
+#undef hal_io_read_port
+
+static enum hal_result_io
+configure_many(const struct hal_io_pin_configuration_entry *table,
+               uint8_t count, uint8_t is_progmem);
 static volatile uint8_t *get_ddr_pointer(enum hal_io_port port);
 static volatile uint8_t *get_port_pointer(enum hal_io_port port);
 static volatile uint8_t *get_pin_pointer(enum hal_io_port port);
 
+/**
+ * Checks if IO port is valid. If not, returns error.
+ */
+#define CHECK_IO_PORT(port)                                                    \
+    CHECK_ARGUMENT(port > hal_io_port_d, hal_result_io_error_invalid_port)
+
 /**
  * Checks if IO pin is valid. If not, returns error.
  */
 #define CHECK_IO_PIN(io)                                                       \
-    if (io.port > hal_io_port_d) {                                             \
-        return hal_result_io_error_invalid_port;                               \
-    }                                                                          \
-    if (io.pin > 8) {                                                          \
-        return hal_result_io_error_invalid_pin;                                \
-    }
+    CHECK_IO_PORT(io.port)                                                     \
+    CHECK_ARGUMENT(io.pin > 7, hal_result_io_error_invalid_pin)
 
 /**
  * Checks if IO pin configuration is valid. If not, returns error.
  */
-#define CHECK_IO_PIN_CONFIGURATION(io)                                         \
-    if (configuration.direction > hal_io_direction_input) {                    \
-        return hal_result_io_error_invalid_direction;                          \
-    }
+#define CHECK_IO_PIN_CONFIGURATION(configuration)                              \
+    CHECK_ARGUMENT(configuration.direction > hal_io_direction_input,           \
+                   hal_result_io_error_invalid_direction)
 
 /**
  * Checks if IO state is valid. If not, returns error.
  */
 #define CHECK_IO_STATE(state)                                                  \
-    if (state > hal_io_state_high) {                                           \
-        return hal_result_io_error_invalid_state;                              \
-    }
+    CHECK_ARGUMENT(state > hal_io_state_high, hal_result_io_error_invalid_state)
 
 /**
  * Configure an I/O pin to either input or output.
@@ -110,6 +123,41 @@ hal_io_configure(struct hal_io_pin io,
     return hal_result_io_ok;
 }
 
+/**
+ * Configure multiple I/O pins from a table in the data memory.
+ *
+ * @param table Pin configurations.
+ * @param count Number of entries in the table.
+ *
+ * @returns If a pin or configuration in the table is invalid, returns related
+ * error without changing any of the pins.
+ *
+ * @see hal_io_configure_many_P
+ */
+enum hal_result_io
+hal_io_configure_many(const struct hal_io_pin_configuration_entry *table,
+                      uint8_t count) {
+    return configure_many(table, count, 0);
+}
+
+/**
+ * Configure multiple I/O pins from a table in the program memory.
+ *
+ * @param table Pin configurations, placed in the program memory with
+ * `PROGMEM`.
+ * @param count Number of entries in the table.
+ *
+ * @returns If a pin or configuration in the table is invalid, returns related
+ * error without changing any of the pins.
+ *
+ * @see hal_io_configure_many
+ */
+enum hal_result_io
+hal_io_configure_many_P(const struct hal_io_pin_configuration_entry *table,
+                        uint8_t count) {
+    return configure_many(table, count, 1);
+}
+
 /**
  * Set state of a given I/O pin.
  *
@@ -179,6 +227,164 @@ enum hal_result_io hal_io_read(struct hal_io_pin io,
     return hal_result_io_ok;
 }
 
+/**
+ * Write a value to all of the pins of a port with a single register write.
+ *
+ * @param port Target port.
+ * @param value New PORTx value. Each bit sets state of the matching pin.
+ *
+ * @returns If given port is invalid, returns related error.
+ * */
+enum hal_result_io hal_io_write_port(enum hal_io_port port, uint8_t value) {
+    CHECK_IO_PORT(port);
+
+    *get_port_pointer(port) = value;
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Set and clear multiple pins of a port with a single, atomic register write.
+ * Pins that are not in either of the masks won't be changed, even if they are
+ * changed from an interrupt.
+ *
+ * @param port Target port.
+ * @param set_mask Pins to set high.
+ * @param clear_mask Pins to set low. If a pin is in both of the masks, it will
+ * be set high.
+ *
+ * @returns If given port is invalid, returns related error.
+ * */
+enum hal_result_io hal_io_modify_port(enum hal_io_port port, uint8_t set_mask,
+                                      uint8_t clear_mask) {
+    volatile uint8_t *port_pointer;
+    uint8_t sreg;
+
+    CHECK_IO_PORT(port);
+
+    port_pointer = get_port_pointer(port);
+
+    ENTER_CRITICAL(sreg);
+    *port_pointer = (*port_pointer & ~clear_mask) | set_mask;
+    EXIT_CRITICAL(sreg);
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Toggle multiple pins of a port with a single register write. Writing to the
+ * PINx register toggles pins without a read-modify-write, so this operation is
+ * atomic too.
+ *
+ * @param port Target port.
+ * @param mask Pins to toggle.
+ *
+ * @returns If given port is invalid, returns related error.
+ * */
+enum hal_result_io hal_io_toggle_port(enum hal_io_port port, uint8_t mask) {
+    CHECK_IO_PORT(port);
+
+    *get_pin_pointer(port) = mask;
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Read all of the pins of a port with a single register read.
+ *
+ * @param port Target port.
+ * @param value Pointer that will hold PINx value. Each bit holds state of the
+ * matching pin.
+ *
+ * @returns If given port is invalid, returns related error.
+ * */
+enum hal_result_io hal_io_read_port(enum hal_io_port port, uint8_t *value) {
+    CHECK_IO_PORT(port);
+
+    *value = *get_pin_pointer(port);
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Groups pin configurations per port and applies them with at most 3 register
+ * writes per port.
+ *
+ * @param table Pin configurations.
+ * @param count Number of entries in the table.
+ * @param is_progmem Is table in the program memory?
+ *
+ * @returns If a pin or configuration in the table is invalid, returns related
+ * error.
+ */
+static enum hal_result_io
+configure_many(const struct hal_io_pin_configuration_entry *table,
+               uint8_t count, uint8_t is_progmem) {
+    struct hal_io_pin_configuration_entry entry;
+    uint8_t output[3] = {0}, pull_up[3] = {0}, tri_state[3] = {0};
+    volatile uint8_t *ddr_pointer, *port_pointer;
+    uint8_t ddr_value, port_value, mask;
+    uint8_t i;
+
+    // Group pins per port, without touching any register. So that an invalid
+    // entry won't leave pins half configured.
+    for (i = 0; i < count; i++) {
+        if (is_progmem) {
+            memcpy_P(&entry, &table[i], sizeof entry);
+        } else {
+            entry = table[i];
+        }
+
+        struct hal_io_pin io = entry.io;
+        struct hal_io_pin_configuration configuration = entry.configuration;
+
+        CHECK_IO_PIN(io);
+        CHECK_IO_PIN_CONFIGURATION(configuration);
+
+        // Later entries override the former ones.
+        mask = BIT(io.pin);
+        output[io.port] &= ~mask;
+        pull_up[io.port] &= ~mask;
+        tri_state[io.port] &= ~mask;
+
+        if (configuration.direction == hal_io_direction_output) {
+            output[io.port] |= mask;
+        } else if (configuration.is_pull_up) {
+            pull_up[io.port] |= mask;
+        } else {
+            tri_state[io.port] |= mask;
+        }
+    }
+
+    for (i = hal_io_port_b; i <= hal_io_port_d; i++) {
+        if (!(output[i] | pull_up[i] | tri_state[i])) {
+            continue;
+        }
+
+        ddr_pointer = get_ddr_pointer(i);
+        port_pointer = get_port_pointer(i);
+
+        ddr_value = *ddr_pointer;
+        port_value = *port_pointer;
+
+        // Intermediate steps, same as the hal_io_configure(): Inputs that will
+        // be outputs are tri-stated, outputs that will be pulled-up inputs
+        // are driven high and outputs that will be tri-state inputs are driven
+        // low.
+        port_value &= ~((output[i] & ~ddr_value) | (tri_state[i] & ddr_value));
+        port_value |= pull_up[i] & ddr_value;
+        *port_pointer = port_value;
+
+        // Set directions.
+        *ddr_pointer = (ddr_value | output[i]) & ~(pull_up[i] | tri_state[i]);
+
+        // Set pull-ups of the inputs.
+        *port_pointer = (port_value | pull_up[i]) & ~tri_state[i];
+    }
+
+    return hal_result_io_ok;
+}
+
 /**
  * Gets DDRx pointer for a port.
  *
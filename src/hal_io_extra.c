@@ -0,0 +1,553 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ *
+ * Extra I/O operations.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_io.h"
+
+#include <avr/io.h>
+#include <stddef.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef hal_io_bitstream_write
+#undef hal_io_debouncer_init
+
+#if defined(__AVR__)
+#ifndef F_CPU
+#warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
+#define F_CPU 16000000UL
+#endif // F_CPU
+#endif // __AVR__
+
+/*******************************************************************************
+ * Parallel bus.
+ ******************************************************************************/
+
+/**
+ * Default strobe pulse width in CPU cycles, 500 ns rounded up. Enough for the
+ * enable pulse of HD44780 compatible LCD controllers and for latches.
+ */
+#if defined(F_CPU)
+#define BUS_STROBE_WIDTH ((F_CPU / 1000000UL * 500 + 999) / 1000)
+#else
+#define BUS_STROBE_WIDTH 8
+#endif // F_CPU
+
+/**
+ * Busy-wait for at least `cycles` CPU cycles, while the strobe pin is active.
+ */
+static inline void bus_strobe_wait(uint8_t cycles) {
+#if defined(__AVR__)
+    // Each iteration takes 3 cycles, last one takes 2.
+    uint8_t count = cycles / 3 + 1;
+
+    __asm__ volatile("1: dec  %[count]\n\t"
+                     "   brne 1b       \n\t"
+                     : [count] "+r"(count));
+#else
+    (void)cycles;
+#endif // __AVR__
+}
+
+/**
+ * Initialize a parallel bus. Only the strobe pin is configured, use
+ * hal_io_bus_set_direction() to set direction of the data pins.
+ *
+ * @param bus Bus to be initialized.
+ * @param pins Data pins, starting from the least significant bit.
+ * @param width Number of data pins. Maximum is 8.
+ * @param strobe Pin that will be pulsed after a write and around a read. It
+ * will be configured as output. `NULL` if there is no strobe pin. Pulse width
+ * is 500 ns, use hal_io_bus_set_strobe_width() to change it.
+ *
+ * @returns If a given pin is invalid, a data pin is given twice, strobe pin is
+ * a data pin too or width is bigger than 8, returns related error. These are
+ * checked in release builds too, as a wrong bus would change other pins of its
+ * ports on each write.
+ */
+enum hal_result_io hal_io_bus_init(struct hal_io_bus *bus,
+                                   const struct hal_io_pin *pins,
+                                   uint8_t width,
+                                   const struct hal_io_pin *strobe) {
+    struct hal_io_pin_configuration configuration = {
+        .direction = hal_io_direction_output,
+    };
+    struct hal_io_bus_segment *segment;
+    enum hal_result_io result;
+    uint8_t i, j;
+
+    if (width > 8) {
+        return hal_result_io_error_invalid_pin;
+    }
+
+    bus->port_count = 0;
+    bus->segment_count = 0;
+    bus->strobe_register = NULL;
+    bus->strobe_mask = 0;
+    bus->strobe_width = BUS_STROBE_WIDTH > 0xFF ? 0xFF : BUS_STROBE_WIDTH;
+    segment = NULL;
+
+    for (i = 0; i < width; i++) {
+        if (pins[i].port > hal_io_port_d) {
+            return hal_result_io_error_invalid_port;
+        }
+        if (pins[i].pin > 7) {
+            return hal_result_io_error_invalid_pin;
+        }
+
+        // Find the port or add it.
+        for (j = 0; j < bus->port_count; j++) {
+            if (bus->ports[j].port_register ==
+                &HAL_IO_PORT_REGISTER(pins[i].port)) {
+                break;
+            }
+        }
+        if (j == bus->port_count) {
+            bus->ports[j].port_register = &HAL_IO_PORT_REGISTER(pins[i].port);
+            bus->ports[j].pin_register = &HAL_IO_PIN_REGISTER(pins[i].port);
+            bus->ports[j].mask = 0;
+            bus->port_count++;
+        }
+        if (bus->ports[j].mask & BIT(pins[i].pin)) {
+            return hal_result_io_error_invalid_pin;
+        }
+        bus->ports[j].mask |= BIT(pins[i].pin);
+
+        // Extend the current segment if this pin is the next one on the same
+        // port. Otherwise, start a new segment.
+        if (segment == NULL || segment->port_index != j ||
+            (int8_t)pins[i].pin - (int8_t)i != segment->shift) {
+            segment = &bus->segments[bus->segment_count++];
+            segment->port_index = j;
+            segment->data_mask = 0;
+            segment->shift = (int8_t)pins[i].pin - (int8_t)i;
+            // Shifting by 8 - n is taking the high byte of a multiplication
+            // by 2^n, so both directions are a single `mul`.
+            segment->write_factor = BIT(segment->shift & 7);
+            segment->read_factor = BIT(-segment->shift & 7);
+        }
+        segment->data_mask |= BIT(i);
+    }
+
+    if (strobe != NULL) {
+        if (strobe->port > hal_io_port_d) {
+            return hal_result_io_error_invalid_port;
+        }
+        if (strobe->pin > 7) {
+            return hal_result_io_error_invalid_pin;
+        }
+        for (j = 0; j < bus->port_count; j++) {
+            if (bus->ports[j].port_register ==
+                    &HAL_IO_PORT_REGISTER(strobe->port) &&
+                bus->ports[j].mask & BIT(strobe->pin)) {
+                return hal_result_io_error_invalid_pin;
+            }
+        }
+
+        result = hal_io_configure(*strobe, configuration);
+        if (result != hal_result_io_ok) {
+            return result;
+        }
+
+        bus->strobe_register = &HAL_IO_PIN_REGISTER(strobe->port);
+        bus->strobe_mask = BIT(strobe->pin);
+    }
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Set width of the strobe pulse.
+ *
+ * @param bus Target bus.
+ * @param cycles Minimum width of the pulse, in CPU cycles. Actual width can be
+ * up to 3 cycles longer.
+ */
+void hal_io_bus_set_strobe_width(struct hal_io_bus *bus, uint8_t cycles) {
+    bus->strobe_width = cycles;
+}
+
+/**
+ * Set direction of all of the data pins of a bus, with a single register write
+ * per port. Inputs won't have pull-ups.
+ *
+ * @param bus Target bus.
+ * @param direction New direction.
+ */
+void hal_io_bus_set_direction(struct hal_io_bus *bus,
+                              enum hal_io_pin_direction direction) {
+    volatile uint8_t *ddr_pointer;
+    struct hal_io_bus_port *port;
+    uint8_t i, sreg;
+
+    for (i = 0; i < bus->port_count; i++) {
+        port = &bus->ports[i];
+        // DDRx is always 1 address below the PORTx.
+        ddr_pointer = port->port_register - 1;
+
+        ENTER_CRITICAL(sreg);
+        if (direction == hal_io_direction_output) {
+            *ddr_pointer |= port->mask;
+        } else {
+            *ddr_pointer &= ~port->mask;
+            *port->port_register &= ~port->mask;
+        }
+        EXIT_CRITICAL(sreg);
+    }
+}
+
+/**
+ * Write a byte to a bus, then pulse the strobe pin if there is one. Every port
+ * is updated with a single atomic read-modify-write.
+ *
+ * @param bus Target bus.
+ * @param data Data to be written.
+ */
+void hal_io_bus_write(struct hal_io_bus *bus, uint8_t data) {
+    uint8_t values[3] = {0};
+    struct hal_io_bus_segment *segment;
+    struct hal_io_bus_port *port;
+    uint16_t product;
+    uint8_t i, bits, sreg;
+
+    for (i = 0; i < bus->segment_count; i++) {
+        segment = &bus->segments[i];
+        bits = data & segment->data_mask;
+
+        product = bits * segment->write_factor;
+
+        if (segment->shift >= 0) {
+            values[segment->port_index] |= (uint8_t)product;
+        } else {
+            values[segment->port_index] |= product >> 8;
+        }
+    }
+
+    for (i = 0; i < bus->port_count; i++) {
+        port = &bus->ports[i];
+
+        ENTER_CRITICAL(sreg);
+        *port->port_register = (*port->port_register & ~port->mask) | values[i];
+        EXIT_CRITICAL(sreg);
+    }
+
+    // Toggle strobe pin twice, so that it's idle state is kept.
+    if (bus->strobe_register != NULL) {
+        *bus->strobe_register = bus->strobe_mask;
+        bus_strobe_wait(bus->strobe_width);
+        *bus->strobe_register = bus->strobe_mask;
+    }
+}
+
+/**
+ * Read a byte from a bus. If there is a strobe pin, it is toggled before the
+ * read and toggled back after it.
+ *
+ * @param bus Target bus.
+ *
+ * @returns Read data.
+ */
+uint8_t hal_io_bus_read(struct hal_io_bus *bus) {
+    uint8_t values[3];
+    struct hal_io_bus_segment *segment;
+    uint16_t product;
+    uint8_t i, bits, data;
+
+    if (bus->strobe_register != NULL) {
+        *bus->strobe_register = bus->strobe_mask;
+
+        // Besides the strobe width, PINx goes through a synchronizer, so a pin
+        // change is seen ~1.5 cycles later. Wait is always at least 2 cycles.
+        bus_strobe_wait(bus->strobe_width);
+    }
+
+    for (i = 0; i < bus->port_count; i++) {
+        values[i] = *bus->ports[i].pin_register;
+    }
+
+    if (bus->strobe_register != NULL) {
+        *bus->strobe_register = bus->strobe_mask;
+    }
+
+    data = 0;
+    for (i = 0; i < bus->segment_count; i++) {
+        segment = &bus->segments[i];
+        bits = values[segment->port_index];
+
+        product = bits * segment->read_factor;
+
+        if (segment->shift > 0) {
+            data |= (product >> 8) & segment->data_mask;
+        } else {
+            data |= product & segment->data_mask;
+        }
+    }
+
+    return data;
+}
+
+/*******************************************************************************
+ * Bitstream output.
+ ******************************************************************************/
+
+#if !defined(__AVR__) || F_CPU >= 8000000UL
+
+#if defined(__AVR__)
+/**
+ * Rounded CPU cycles for the given nanoseconds.
+ */
+#define BITSTREAM_CYCLES(ns) ((F_CPU / 1000000UL * (ns) + 500) / 1000)
+
+/**
+ * Extra cycles to wait, after the rising edge of a bit, until the falling edge
+ * of a 0 bit (375 ns high).
+ */
+#define BITSTREAM_ZERO_NOPS (BITSTREAM_CYCLES(375) - 2)
+
+/**
+ * Extra cycles to wait, after the falling edge of a 0 bit, until the falling
+ * edge of a 1 bit (750 ns high).
+ */
+#define BITSTREAM_ONE_NOPS (BITSTREAM_CYCLES(750) - BITSTREAM_ZERO_NOPS - 4)
+
+/**
+ * Extra cycles to wait, after the falling edge of a 1 bit, until the end of the
+ * bit (1.25 µs total).
+ */
+#define BITSTREAM_LOW_NOPS                                                     \
+    (BITSTREAM_CYCLES(1250) - BITSTREAM_ZERO_NOPS - BITSTREAM_ONE_NOPS - 8)
+
+/**
+ * Sends `length` bytes from `data`, most significant bit first, by writing
+ * `high` and `low` to the PORTx register at the I/O address `io_address`.
+ *
+ * After the rising edge, a 0 bit falls after 2 + BITSTREAM_ZERO_NOPS cycles,
+ * from the first `out` of low. For a 1 bit, that `out` is skipped and it falls
+ * 4 + BITSTREAM_ZERO_NOPS + BITSTREAM_ONE_NOPS cycles after the rising edge.
+ * Loop takes 8 cycles besides the extra cycles. Between bytes, low time is 6
+ * cycles longer, which is within the tolerance of the LEDs.
+ *
+ * Compiler doesn't know that the loop reads the bytes, so the `memory` clobber
+ * makes sure that they are stored before it.
+ */
+#define BITSTREAM_LOOP(io_address, data, length, high, low)                    \
+    do {                                                                       \
+        uint8_t byte, bits;                                                    \
+        __asm__ volatile("1:                   \n\t"                           \
+                         "ld   %[byte], %a[data]+\n\t"                         \
+                         "ldi  %[bits], 8      \n\t"                           \
+                         "2:                   \n\t"                           \
+                         "out  %[port], %[high]\n\t"                           \
+                         ".rept %[zero_nops]   \n\t"                           \
+                         "nop                  \n\t"                           \
+                         ".endr                \n\t"                           \
+                         "sbrs %[byte], 7      \n\t"                           \
+                         "out  %[port], %[low] \n\t"                           \
+                         "lsl  %[byte]         \n\t"                           \
+                         ".rept %[one_nops]    \n\t"                           \
+                         "nop                  \n\t"                           \
+                         ".endr                \n\t"                           \
+                         "out  %[port], %[low] \n\t"                           \
+                         ".rept %[low_nops]    \n\t"                           \
+                         "nop                  \n\t"                           \
+                         ".endr                \n\t"                           \
+                         "dec  %[bits]         \n\t"                           \
+                         "brne 2b              \n\t"                           \
+                         "sbiw %[length], 1    \n\t"                           \
+                         "brne 1b              \n\t"                           \
+                         : [byte] "=&r"(byte), [bits] "=&d"(bits),             \
+                           [data] "+e"(data), [length] "+w"(length)            \
+                         : [port] "I"(io_address), [high] "r"(high),           \
+                           [low] "r"(low),                                     \
+                           [zero_nops] "I"(BITSTREAM_ZERO_NOPS),               \
+                           [one_nops] "I"(BITSTREAM_ONE_NOPS),                 \
+                           [low_nops] "I"(BITSTREAM_LOW_NOPS)                  \
+                         : "memory");                                          \
+    } while (0)
+#endif // __AVR__
+
+/**
+ * Send bytes as a WS2812 style bitstream on a pin. Pin should already be
+ * configured as output and be low. Interrupts are disabled until all of the
+ * bytes are sent.
+ *
+ * @param io Target pin.
+ * @param data Bytes to be sent, most significant bit first.
+ * @param length Number of bytes.
+ *
+ * @returns If given pin is invalid, returns related error.
+ */
+enum hal_result_io hal_io_bitstream_write(struct hal_io_pin io,
+                                          const uint8_t *data,
+                                          uint16_t length) {
+    volatile uint8_t *port_pointer;
+    uint8_t high, low, sreg;
+
+    CHECK_ARGUMENT(io.port > hal_io_port_d, hal_result_io_error_invalid_port);
+    CHECK_ARGUMENT(io.pin > 7, hal_result_io_error_invalid_pin);
+    if (length == 0) {
+        return hal_result_io_ok;
+    }
+
+    port_pointer = &HAL_IO_PORT_REGISTER(io.port);
+
+    ENTER_CRITICAL(sreg);
+
+    // Other pins of the port can't change while interrupts are disabled, so
+    // both of the port values can be calculated beforehand.
+    high = *port_pointer | BIT(io.pin);
+    low = *port_pointer & ~BIT(io.pin);
+
+#if defined(__AVR__)
+    // I/O address should be a constant for the `out` instruction.
+    switch (io.port) {
+    case hal_io_port_b:
+        BITSTREAM_LOOP(_SFR_IO_ADDR(PORTB), data, length, high, low);
+        break;
+    case hal_io_port_c:
+        BITSTREAM_LOOP(_SFR_IO_ADDR(PORTC), data, length, high, low);
+        break;
+    default:
+    case hal_io_port_d:
+        BITSTREAM_LOOP(_SFR_IO_ADDR(PORTD), data, length, high, low);
+        break;
+    }
+#else
+    // There is no cycle timing on host machine, only the port writes.
+    for (; length > 0; length--, data++) {
+        for (uint8_t bit = 0x80; bit; bit >>= 1) {
+            *port_pointer = high;
+            if (!(*data & bit)) {
+                *port_pointer = low;
+            }
+            *port_pointer = low;
+        }
+    }
+#endif // __AVR__
+
+    EXIT_CRITICAL(sreg);
+
+    return hal_result_io_ok;
+}
+
+#else
+#warning "F_CPU is below 8 MHz, hal_io_bitstream_write() is left out."
+#endif // !__AVR__ || F_CPU >= 8000000UL
+
+/*******************************************************************************
+ * Debouncer.
+ ******************************************************************************/
+
+/**
+ * Initialize a debouncer. Current pin states are taken as debounced state, so
+ * that pins that are already active won't be reported as pressed.
+ *
+ * @param debouncer Debouncer to be initialized.
+ * @param port Port to be debounced.
+ * @param active_low_mask Pins that are active when they are low, like buttons
+ * with pull-ups. Other pins are active when they are high.
+ *
+ * @returns If given port is invalid, returns related error.
+ */
+enum hal_result_io hal_io_debouncer_init(struct hal_io_debouncer *debouncer,
+                                         enum hal_io_port port,
+                                         uint8_t active_low_mask) {
+    CHECK_ARGUMENT(port > hal_io_port_d, hal_result_io_error_invalid_port);
+
+    debouncer->pin_register = &HAL_IO_PIN_REGISTER(port);
+    debouncer->active_low_mask = active_low_mask;
+    debouncer->state = *debouncer->pin_register ^ active_low_mask;
+    debouncer->counter_0 = 0xFF;
+    debouncer->counter_1 = 0xFF;
+    debouncer->pressed = 0;
+    debouncer->released = 0;
+
+    return hal_result_io_ok;
+}
+
+/**
+ * Sample the port and advance vertical counters. Should be called
+ * periodically, typically from a timer interrupt.
+ *
+ * @param debouncer Target debouncer.
+ */
+void hal_io_debouncer_tick(struct hal_io_debouncer *debouncer) {
+    uint8_t changed, counter_0, counter_1, state;
+
+    state = debouncer->state;
+
+    // Pins that are different from the debounced state.
+    changed = (*debouncer->pin_register ^ debouncer->active_low_mask) ^ state;
+
+    // Counters of the changed pins count down from 3 and roll over to 3 after
+    // 0. Counters of the unchanged pins are reset to 3.
+    counter_0 = ~(debouncer->counter_0 & changed);
+    counter_1 = counter_0 ^ (debouncer->counter_1 & changed);
+    debouncer->counter_0 = counter_0;
+    debouncer->counter_1 = counter_1;
+
+    // Pins that rolled over have been changed for 4 ticks in a row.
+    changed &= counter_0 & counter_1;
+    state ^= changed;
+    debouncer->state = state;
+
+    debouncer->pressed |= state & changed;
+    debouncer->released |= ~state & changed;
+}
+
+/**
+ * Get debounced state of the pins.
+ *
+ * @param debouncer Target debouncer.
+ *
+ * @returns Debounced state. A bit is 1 if matching pin is active.
+ */
+uint8_t hal_io_debouncer_get_state(struct hal_io_debouncer *debouncer) {
+    return debouncer->state;
+}
+
+/**
+ * Get and clear pins that became active since the last call.
+ *
+ * @param debouncer Target debouncer.
+ * @param mask Pins to get and clear.
+ *
+ * @returns Pins in the `mask` that became active.
+ */
+uint8_t hal_io_debouncer_get_pressed(struct hal_io_debouncer *debouncer,
+                                     uint8_t mask) {
+    uint8_t pressed, sreg;
+
+    ENTER_CRITICAL(sreg);
+    pressed = debouncer->pressed & mask;
+    debouncer->pressed &= ~mask;
+    EXIT_CRITICAL(sreg);
+
+    return pressed;
+}
+
+/**
+ * Get and clear pins that became inactive since the last call.
+ *
+ * @param debouncer Target debouncer.
+ * @param mask Pins to get and clear.
+ *
+ * @returns Pins in the `mask` that became inactive.
+ */
+uint8_t hal_io_debouncer_get_released(struct hal_io_debouncer *debouncer,
+                                      uint8_t mask) {
+    uint8_t released, sreg;
+
+    ENTER_CRITICAL(sreg);
+    released = debouncer->released & mask;
+    debouncer->released &= ~mask;
+    EXIT_CRITICAL(sreg);
+
+    return released;
+}
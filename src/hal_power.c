@@ -14,6 +14,10 @@
 #include <avr/io.h>
 #include <avr/sleep.h>
 
+// Checking wrappers of the header are for the callers only.
+#undef hal_power_set_sleep_mode
+#undef hal_power_set_module_power
+
 /**
  * @brief Set sleep mode for ATmega328P.
  *
@@ -33,7 +37,7 @@ hal_power_set_sleep_mode(enum hal_power_sleep_modes mode) {
     case hal_power_external_standby_mode:
         break;
     default:
-        return hal_result_power_illegal_mode;
+        INVALID_ARGUMENT(hal_result_power_illegal_mode);
     }
 
     // Assign new mode. Other bits of the register should be 0.
@@ -72,7 +76,7 @@ enum hal_result_power hal_power_set_module_power(enum hal_power_modules module,
     case hal_power_twi:
         break;
     default:
-        return hal_result_power_module_not_found;
+        INVALID_ARGUMENT(hal_result_power_module_not_found);
     }
 
     if (state)
@@ -13,6 +13,9 @@
 
 #include <avr/io.h>
 
+// Checking wrappers of the header are for the callers only.
+#undef hal_power_change_module_powers
+
 /**
  * @brief Changes multiple module powers with a single register write. Use
  * #hal_power_modules to generate power on and off bytes.
@@ -25,14 +28,12 @@
 enum hal_result_power hal_power_change_module_powers(uint8_t power_off_list,
                                                      uint8_t power_on_list) {
     // Check if the reserved bit is used.
-    if (power_off_list == BIT(4) || power_on_list == BIT(4)) {
-        return hal_result_power_bit_is_reserved;
-    }
+    CHECK_ARGUMENT(power_off_list == BIT(4) || power_on_list == BIT(4),
+                   hal_result_power_bit_is_reserved);
 
     // Check if power off and on lists has same bit set.
-    if (!(power_off_list ^ power_on_list)) {
-        return hal_result_power_same_bit_set_for_power_management;
-    }
+    CHECK_ARGUMENT(!(power_off_list ^ power_on_list),
+                   hal_result_power_same_bit_set_for_power_management);
 
     uint8_t new_state = PRR;
     new_state |= power_off_list;
@@ -14,6 +14,9 @@
 #include <avr/io.h>
 #include <avr/wdt.h>
 
+// Checking wrappers of the header are for the callers only.
+#undef hal_system_set_watchdog
+
 /**
  * @brief Reset watchdog timer counter.
  * */
@@ -32,13 +35,11 @@ hal_system_set_watchdog(struct hal_system_watchdog_t config) {
 
     control_register = 0;
 
-    if (config.cycles > hal_system_watchdog_1024k_cycles) {
-        return hal_result_system_invalid_watchdog_cycles;
-    }
+    CHECK_ARGUMENT(config.cycles > hal_system_watchdog_1024k_cycles,
+                   hal_result_system_invalid_watchdog_cycles);
 
-    if (config.mode > hal_system_watchdog_interrupt_and_reset_mode) {
-        return hal_result_system_invalid_watchdog_mode;
-    }
+    CHECK_ARGUMENT(config.mode > hal_system_watchdog_interrupt_and_reset_mode,
+                   hal_result_system_invalid_watchdog_mode);
 
     // Save operating mode.
     switch (config.mode) {
@@ -57,9 +58,13 @@ hal_system_set_watchdog(struct hal_system_watchdog_t config) {
         break;
     }
 
-    // If watchdog timer is not disabled, save cycles.
+    // If watchdog timer is not disabled, save cycles. WDP3 is not next to the
+    // other prescaler bits, WDE is in between.
     if (config.mode != hal_system_watchdog_disabled) {
-        control_register |= (config.cycles << WDP0);
+        control_register |= (config.cycles & 0b111) << WDP0;
+        if (config.cycles & 0b1000) {
+            SET_BIT(control_register, WDP3);
+        }
     }
     CLEAR_BIT(control_register, WDCE);
 
@@ -14,6 +14,22 @@
 
 #include <avr/io.h>
 
+// Checking wrappers of the header are for the callers only.
+#undef hal_timer0_set_operation_mode
+#undef hal_timer0_set_output_compare_mode
+#undef hal_timer0_set_output_compare_value
+#undef hal_timer0_set_clock_source
+#undef hal_timer0_interrupt_enable
+#undef hal_timer0_interrupt_disable
+#undef hal_timer0_interrupt_clear
+
+/**
+ * Checks if timer0 interrupt is valid. If not, returns error.
+ */
+#define CHECK_TIMER0_INTERRUPT(interrupt)                                      \
+    CHECK_ARGUMENT(interrupt > hal_timer0_interrupt_compare_b,                 \
+                   hal_result_timer0_invalid_interrupt)
+
 /**
  * @brief Get current timer0 counter value.
  * @returns 8 bit value of the timer0 counter.
@@ -52,12 +68,28 @@ hal_timer0_set_operation_mode(enum hal_timer0_operation_modes mode) {
         CLEAR_BIT(tccr0a, WGM00);
         break;
     case hal_timer0_mode_fast_pwm:
+        CLEAR_BIT(tccr0b, WGM02);
+        SET_BIT(tccr0a, WGM01);
+        SET_BIT(tccr0a, WGM00);
         break;
     case hal_timer0_mode_phase_correct_pwm:
+        CLEAR_BIT(tccr0b, WGM02);
+        CLEAR_BIT(tccr0a, WGM01);
+        SET_BIT(tccr0a, WGM00);
+        break;
+    case hal_timer0_mode_fast_pwm_ocr0a_top:
+        SET_BIT(tccr0b, WGM02);
+        SET_BIT(tccr0a, WGM01);
+        SET_BIT(tccr0a, WGM00);
+        break;
+    case hal_timer0_mode_phase_correct_pwm_ocr0a_top:
+        SET_BIT(tccr0b, WGM02);
+        CLEAR_BIT(tccr0a, WGM01);
+        SET_BIT(tccr0a, WGM00);
         break;
 
     default:
-        return hal_result_timer0_invalid_operation_mode;
+        INVALID_ARGUMENT(hal_result_timer0_invalid_operation_mode);
     }
 
     TCCR0A = tccr0a;
@@ -116,7 +148,7 @@ hal_timer0_set_output_compare_mode(enum hal_timer0_output_compare_register reg,
         break;
 
     default:
-        return hal_result_timer0_invalid_output_compare_register;
+        INVALID_ARGUMENT(hal_result_timer0_invalid_output_compare_register);
     }
 
     // Change the register.
@@ -140,7 +172,7 @@ hal_timer0_set_output_compare_mode(enum hal_timer0_output_compare_register reg,
         break;
 
     default:
-        return hal_result_timer0_invalid_output_compare_mode;
+        INVALID_ARGUMENT(hal_result_timer0_invalid_output_compare_mode);
     }
 
     // Write new value to register.
@@ -149,6 +181,35 @@ hal_timer0_set_output_compare_mode(enum hal_timer0_output_compare_register reg,
     return hal_result_timer0_ok;
 }
 
+/**
+ * @brief Set output compare register value. In PWM modes, it is the duty
+ * cycle. It can be changed while the timer runs, since the hardware double
+ * buffers it and updates it at the top or bottom of the count. In other modes,
+ * it is updated immediately.
+ *
+ * @param reg Output compare register to set.
+ * @param value New value of the register.
+ *
+ * @return Error if given register is invalid, ok otherwise.
+ */
+enum hal_result_timer0
+hal_timer0_set_output_compare_value(enum hal_timer0_output_compare_register reg,
+                                    uint8_t value) {
+    switch (reg) {
+    case hal_timer0_output_compare_register_a:
+        OCR0A = value;
+        break;
+    case hal_timer0_output_compare_register_b:
+        OCR0B = value;
+        break;
+
+    default:
+        INVALID_ARGUMENT(hal_result_timer0_invalid_output_compare_register);
+    }
+
+    return hal_result_timer0_ok;
+}
+
 /**
  * @brief Set timer0's clock source
  */
@@ -199,7 +260,7 @@ hal_timer0_set_clock_source(enum hal_timer0_clock_source source) {
         break;
 
     default:
-        return hal_result_timer0_invalid_clock_source;
+        INVALID_ARGUMENT(hal_result_timer0_invalid_clock_source);
         break;
     }
 
@@ -207,3 +268,53 @@ hal_timer0_set_clock_source(enum hal_timer0_clock_source source) {
 
     return hal_result_timer0_ok;
 }
+
+/**
+ * @brief Enable a timer0 interrupt. Its handler should be bound with one of
+ * the `HAL_TIMER0_*_ISR` macros.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_timer0
+hal_timer0_interrupt_enable(enum hal_timer0_interrupt interrupt) {
+    CHECK_TIMER0_INTERRUPT(interrupt);
+
+    SET_BIT(TIMSK0, interrupt);
+
+    return hal_result_timer0_ok;
+}
+
+/**
+ * @brief Disable a timer0 interrupt.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_timer0
+hal_timer0_interrupt_disable(enum hal_timer0_interrupt interrupt) {
+    CHECK_TIMER0_INTERRUPT(interrupt);
+
+    CLEAR_BIT(TIMSK0, interrupt);
+
+    return hal_result_timer0_ok;
+}
+
+/**
+ * @brief Clear pending flag of a timer0 interrupt.
+ *
+ * @param interrupt Target interrupt.
+ *
+ * @returns Error if given interrupt is invalid.
+ */
+enum hal_result_timer0
+hal_timer0_interrupt_clear(enum hal_timer0_interrupt interrupt) {
+    CHECK_TIMER0_INTERRUPT(interrupt);
+
+    // Flag is cleared by writing 1 to it.
+    TIFR0 = BIT(interrupt);
+
+    return hal_result_timer0_ok;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ *
+ * @brief Timer module, software timers on the system tick.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_timer0.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stddef.h>
+
+#ifndef F_CPU
+#warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
+#define F_CPU 16000000UL
+#endif // F_CPU
+
+#if HAL_TIMER0_WHEEL_SLOTS < 2 || HAL_TIMER0_WHEEL_SLOTS > 32 ||               \
+    (HAL_TIMER0_WHEEL_SLOTS & (HAL_TIMER0_WHEEL_SLOTS - 1))
+#error "HAL_TIMER0_WHEEL_SLOTS should be a power of 2, between 2 and 32."
+#endif
+
+/**
+ * Timer0 counts in a slot of the wheel, which is an overflow period.
+ */
+#define SLOT_COUNTS 256
+
+/**
+ * @brief Convert milliseconds to timer0 counts, without a division.
+ */
+#define MILLIS_TO_COUNTS(ms) ((uint32_t)(ms) * (F_CPU / 1000) >> 6)
+
+/**
+ * Timers of each slot, as doubly linked lists. A timer is in the slot of its
+ * overflow period, so timers of later turns share the slot.
+ */
+static struct hal_timer0_timer *wheel[HAL_TIMER0_WHEEL_SLOTS];
+
+/**
+ * A bit for each slot, set if the slot is not empty.
+ */
+static uint32_t wheel_occupied;
+
+/**
+ * Time until which the timers are expired, in timer0 counts.
+ */
+static uint32_t wheel_time;
+
+/**
+ * Time of the alarm that is set for the wheel. Valid if `is_alarm_set`.
+ */
+static uint32_t wheel_alarm;
+static uint8_t is_alarm_set;
+
+static void expire_timers(void);
+
+/**
+ * @brief Get the slot of a time.
+ */
+static inline uint8_t slot_of(uint32_t counts) {
+    return (counts / SLOT_COUNTS) & (HAL_TIMER0_WHEEL_SLOTS - 1);
+}
+
+/**
+ * @brief Add a timer to the slot of its deadline.
+ */
+static void insert_timer(struct hal_timer0_timer *timer) {
+    uint8_t slot = slot_of(timer->deadline);
+
+    timer->prev = NULL;
+    timer->next = wheel[slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    wheel[slot] = timer;
+    wheel_occupied |= (uint32_t)1 << slot;
+}
+
+/**
+ * @brief Remove a timer from its slot.
+ */
+static void remove_timer(struct hal_timer0_timer *timer) {
+    uint8_t slot = slot_of(timer->deadline);
+
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel[slot] = timer->next;
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    if (wheel[slot] == NULL) {
+        wheel_occupied &= ~((uint32_t)1 << slot);
+    }
+
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->callback = NULL;
+}
+
+/**
+ * @brief Set the alarm for a time, if it is earlier than the current alarm.
+ */
+static void request_alarm(uint32_t counts) {
+    if (is_alarm_set && (int32_t)(counts - wheel_alarm) >= 0) {
+        return;
+    }
+
+    wheel_alarm = counts;
+    is_alarm_set = hal_timer0_tick_set_alarm(counts, expire_timers) ==
+                   hal_result_timer0_ok;
+}
+
+/**
+ * @brief Set the alarm for the next timer, after the timers until
+ * `wheel_time` are expired.
+ *
+ * Slots are searched in the order of time, starting from the current one. The
+ * first slot that has a timer of the current turn has the next one, since the
+ * rest of the timers that are seen are of later turns. If there is none, the
+ * earliest of the later turns is the next one.
+ */
+static void schedule_next(void) {
+    struct hal_timer0_timer *timer;
+    uint32_t slot_end, next;
+    uint8_t start, slot, offset, is_found;
+
+    is_alarm_set = 0;
+    if (wheel_occupied == 0) {
+        return;
+    }
+
+    start = slot_of(wheel_time);
+    slot_end = wheel_time & ~(uint32_t)(SLOT_COUNTS - 1);
+    next = 0;
+    is_found = 0;
+    for (offset = 0; offset < HAL_TIMER0_WHEEL_SLOTS; offset++) {
+        slot = (start + offset) & (HAL_TIMER0_WHEEL_SLOTS - 1);
+        slot_end += SLOT_COUNTS;
+        if (!(wheel_occupied & (uint32_t)1 << slot)) {
+            continue;
+        }
+
+        for (timer = wheel[slot]; timer; timer = timer->next) {
+            if (!is_found || (int32_t)(timer->deadline - next) < 0) {
+                next = timer->deadline;
+                is_found = 1;
+            }
+        }
+        if ((int32_t)(next - slot_end) < 0) {
+            break;
+        }
+    }
+
+    request_alarm(next);
+}
+
+/**
+ * @brief Alarm handler. Expires the timers whose deadlines have passed, then
+ * sets the alarm for the next one. Runs with interrupts disabled.
+ */
+static void expire_timers(void) {
+    struct hal_timer0_timer *timer;
+    void (*callback)(struct hal_timer0_timer *);
+    uint32_t now, periods;
+    uint8_t slot, slots;
+
+    is_alarm_set = 0;
+    now = hal_timer0_tick_get_counts();
+
+    // Visit each slot from the last expiry until now, at most once.
+    periods = now / SLOT_COUNTS - wheel_time / SLOT_COUNTS;
+    slots = periods < HAL_TIMER0_WHEEL_SLOTS ? periods + 1
+                                             : HAL_TIMER0_WHEEL_SLOTS;
+    slot = slot_of(wheel_time);
+    wheel_time = now;
+
+    while (slots--) {
+        timer = wheel[slot];
+        while (timer) {
+            if ((int32_t)(timer->deadline - now) > 0) {
+                timer = timer->next;
+                continue;
+            }
+
+            callback = timer->callback;
+            remove_timer(timer);
+
+            // Periodic timers are restarted before the callback, which can
+            // stop them. Periods that are missed are skipped.
+            if (timer->period != 0) {
+                do {
+                    timer->deadline += timer->period;
+                } while ((int32_t)(timer->deadline - now) <= 0);
+                timer->callback = callback;
+                insert_timer(timer);
+            }
+
+            callback(timer);
+
+            // Callback can start and stop timers, so start over.
+            timer = wheel[slot];
+        }
+
+        slot = (slot + 1) & (HAL_TIMER0_WHEEL_SLOTS - 1);
+    }
+
+    schedule_next();
+}
+
+/**
+ * @brief Start a software timer. Its callback is called from the timer0 output
+ * compare B interrupt, after the delay, and then periodically if a period is
+ * given. Takes O(1) time. A running timer is restarted.
+ *
+ * System tick should be started, see hal_timer0_tick_init(). Timers are kept in
+ * a wheel of `HAL_TIMER0_WHEEL_SLOTS` overflow periods, and the alarm of the
+ * tick is set for the next deadline. So the alarm can't be used for anything
+ * else.
+ *
+ * @param timer Timer, which must stay valid while it runs. Statically
+ * allocated by the caller.
+ * @param delay_ms Delay until the first call, in milliseconds.
+ * @param period_ms Period of the next calls in milliseconds. 0 for a one-shot
+ * timer.
+ * @param callback Called when the timer expires, with interrupts disabled.
+ */
+void hal_timer0_timer_start(struct hal_timer0_timer *timer, uint16_t delay_ms,
+                            uint16_t period_ms,
+                            void (*callback)(struct hal_timer0_timer *)) {
+    uint32_t now;
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    if (timer->callback) {
+        remove_timer(timer);
+    }
+
+    now = hal_timer0_tick_get_counts();
+    if (wheel_occupied == 0) {
+        wheel_time = now;
+    }
+
+    timer->deadline = now + MILLIS_TO_COUNTS(delay_ms);
+    timer->period = MILLIS_TO_COUNTS(period_ms);
+    timer->callback = callback;
+    insert_timer(timer);
+
+    request_alarm(timer->deadline);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Stop a software timer, if it runs. Takes O(1) time. Alarm is left as
+ * is, it finds no timer to expire if this one was the next.
+ *
+ * @param timer Timer to stop.
+ */
+void hal_timer0_timer_stop(struct hal_timer0_timer *timer) {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    if (timer->callback) {
+        remove_timer(timer);
+    }
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Check if a software timer runs.
+ *
+ * @param timer Timer to check.
+ *
+ * @returns 1 if it runs, 0 otherwise.
+ */
+uint8_t hal_timer0_timer_is_running(struct hal_timer0_timer *timer) {
+    return timer->callback != NULL;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ *
+ * @brief Timer module, tickless idle on the system tick and the watchdog.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_power.h"
+#include "hal_system.h"
+#include "hal_timer0.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <stdint.h>
+
+#ifndef F_CPU
+#warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
+#define F_CPU 16000000UL
+#endif // F_CPU
+
+/**
+ * Timer0 counts in the shortest watchdog period, 2k cycles of its 128 kHz
+ * oscillator. Each longer period is twice the previous one.
+ */
+#define WATCHDOG_COUNTS ((uint32_t)16 * (F_CPU / 1000) >> 6)
+
+/**
+ * Whether the watchdog is started by hal_timer0_idle(), and has not fired yet.
+ */
+static volatile uint8_t is_watchdog_running;
+
+/**
+ * Time when the watchdog is started, and its period, in timer0 counts. Valid
+ * while `is_watchdog_running`.
+ */
+static uint32_t watchdog_start;
+static uint32_t watchdog_counts;
+
+/**
+ * @brief Write the watchdog control register, with the timed sequence of
+ * hal_system_set_watchdog(). Interrupts should be disabled, and they are not
+ * enabled afterwards.
+ */
+static inline void set_watchdog_control(uint8_t control) {
+    wdt_reset();
+    WDTCSR |= BIT(WDCE) | BIT(WDE);
+    WDTCSR = control;
+}
+
+/**
+ * Watchdog interrupt, only enabled by hal_timer0_idle(). Timer0 counted only
+ * while the CPU was awake since the watchdog is started, so the rest of its
+ * period is added to the tick. This is the time slept with timer0 stopped,
+ * whether the watchdog or another interrupt woke up the CPU.
+ */
+ISR(WDT_vect) {
+    uint32_t awake;
+
+    set_watchdog_control(0);
+    is_watchdog_running = 0;
+
+    awake = hal_timer0_tick_get_counts() - watchdog_start;
+    if (awake < watchdog_counts) {
+        hal_timer0_tick_advance(watchdog_counts - awake);
+    }
+}
+
+/**
+ * @brief Find the deepest sleep mode that the running peripherals allow.
+ * Timer0 is not counted, its time is corrected after the sleep.
+ *
+ * ADC, SPI and TWI have no drivers to tell if they are in use, so they are
+ * taken as running unless powered off with hal_power_set_module_power().
+ */
+static enum hal_power_sleep_modes deepest_sleep_mode(void) {
+    uint8_t powered = ~PRR;
+
+    if (powered & (BIT(PRADC) | BIT(PRSPI) | BIT(PRTWI))) {
+        return hal_power_idle_mode;
+    }
+    if ((powered & BIT(PRUSART0)) && (UCSR0B & (BIT(RXEN0) | BIT(TXEN0)))) {
+        return hal_power_idle_mode;
+    }
+    if ((powered & BIT(PRTIM1)) &&
+        (TCCR1B & (BIT(CS12) | BIT(CS11) | BIT(CS10)))) {
+        return hal_power_idle_mode;
+    }
+
+    // Compare outputs of timer0, e.g. PWM, would stop with its clock.
+    if (TCCR0A & (BIT(COM0A1) | BIT(COM0A0) | BIT(COM0B1) | BIT(COM0B0))) {
+        return hal_power_idle_mode;
+    }
+
+    // Timer2 keeps running in power-save mode, only if it is asynchronous.
+    if ((powered & BIT(PRTIM2)) &&
+        (TCCR2B & (BIT(CS22) | BIT(CS21) | BIT(CS20)))) {
+        return bit_is_set(ASSR, AS2) ? hal_power_power_save_mode
+                                     : hal_power_idle_mode;
+    }
+
+    return hal_power_power_down_mode;
+}
+
+/**
+ * @brief Sleep until the alarm of the tick, which is set for the next software
+ * timer, in the deepest sleep mode that the running peripherals allow. Meant
+ * to be called from the main loop, when there is nothing else to do.
+ * Interrupts are enabled when it returns.
+ *
+ * If the next deadline is closer than 16 ms, or a peripheral needs the I/O
+ * clock, CPU sleeps in idle mode and timer0 wakes it up. Otherwise timer0
+ * stops in power-down (or power-save) mode, and the watchdog is started with
+ * its longest period that ends before the deadline. Its interrupt advances the
+ * tick by the part of the period that timer0 didn't count, see
+ * hal_timer0_tick_advance().
+ *
+ * If another interrupt wakes the CPU up first, the watchdog keeps running, and
+ * the tick is corrected when it fires. Until then, the tick lags behind by the
+ * time slept, and the next calls sleep until the same watchdog interrupt.
+ *
+ * Checks are done with interrupts disabled, which are only enabled right
+ * before the sleep instruction. So an interrupt that sets an earlier alarm
+ * can't run between them, and wakes the CPU up instead.
+ *
+ * Corrected time is as precise as the watchdog oscillator, which is not
+ * calibrated. Watchdog can't be used in reset mode at the same time, then CPU
+ * always sleeps in idle mode.
+ */
+void hal_timer0_idle() {
+    enum hal_power_sleep_modes mode;
+    uint32_t now, deadline, remaining, elapsed;
+    uint8_t cycles;
+
+    cli();
+    now = hal_timer0_tick_get_counts();
+    remaining = UINT32_MAX;
+    if (hal_timer0_tick_get_alarm(&deadline)) {
+        remaining = deadline - now;
+        if ((int32_t)remaining < 0) {
+            remaining = 0;
+        }
+    }
+    mode = deepest_sleep_mode();
+
+    if (is_watchdog_running) {
+        // Watchdog of an earlier sleep is still running. Timer0 stops only if
+        // it fires before the deadline.
+        elapsed = now - watchdog_start;
+        if (elapsed < watchdog_counts &&
+            watchdog_counts - elapsed > remaining) {
+            mode = hal_power_idle_mode;
+        }
+    } else if (mode == hal_power_idle_mode || remaining < WATCHDOG_COUNTS ||
+               bit_is_set(WDTCSR, WDE)) {
+        mode = hal_power_idle_mode;
+    } else {
+        // Longest watchdog period that ends before the deadline. WDP3 is not
+        // next to the other prescaler bits, WDE is in between.
+        cycles = hal_system_watchdog_2k_cycles;
+        while (cycles < hal_system_watchdog_1024k_cycles &&
+               WATCHDOG_COUNTS << (cycles + 1) <= remaining) {
+            cycles++;
+        }
+
+        watchdog_start = now;
+        watchdog_counts = WATCHDOG_COUNTS << cycles;
+        is_watchdog_running = 1;
+        set_watchdog_control(BIT(WDIE) | (cycles & 0b111) << WDP0 |
+                             (cycles & 0b1000 ? BIT(WDP3) : 0));
+    }
+
+    SMCR = mode << 1;
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
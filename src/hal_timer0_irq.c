@@ -0,0 +1,432 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ *
+ * @brief Timer module, interrupt driven system tick.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_timer0.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <stddef.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef hal_timer0_set_clock_source
+
+#ifndef F_CPU
+#warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
+#define F_CPU 16000000UL
+#endif // F_CPU
+
+/**
+ * CPU cycles between two overflows, with the prescaler of 64.
+ */
+#define TICK_OVERFLOW_CYCLES (64UL * 256)
+
+/**
+ * CPU cycles in a millisecond.
+ */
+#define TICK_MILLISECOND_CYCLES (F_CPU / 1000)
+
+/**
+ * Whole milliseconds and the remaining cycles, that are added on each
+ * overflow.
+ */
+#define TICK_MILLIS_PER_OVERFLOW                                               \
+    (TICK_OVERFLOW_CYCLES / TICK_MILLISECOND_CYCLES)
+#define TICK_FRACTION_PER_OVERFLOW                                             \
+    (TICK_OVERFLOW_CYCLES % TICK_MILLISECOND_CYCLES)
+
+/**
+ * CPU cycles in a microsecond.
+ */
+#define TICK_MICROSECOND_CYCLES (F_CPU / 1000000)
+
+#if TICK_MILLISECOND_CYCLES > 0xFFFF
+#error "F_CPU is too high for the system tick."
+#endif
+
+/**
+ * Milliseconds since the tick is started.
+ */
+static volatile uint32_t tick_millis;
+
+/**
+ * Cycles that are less than a millisecond, carried to the next overflow.
+ */
+static volatile uint16_t tick_fraction;
+
+/**
+ * Overflows since the tick is started.
+ */
+static volatile uint32_t tick_overflows;
+
+/**
+ * When the alarm fires, in timer0 counts.
+ */
+static volatile uint32_t alarm_time;
+
+/**
+ * Called when the alarm fires. NULL if there is no alarm.
+ */
+static void (*volatile alarm_handler)(void);
+
+/**
+ * Whether OCR0B is written for the alarm, before the overflow that takes it
+ * in fast PWM mode.
+ */
+static volatile uint8_t alarm_is_buffered;
+
+/**
+ * Value that is written to OCR0B for the alarm, in fast PWM mode.
+ */
+static volatile uint8_t alarm_compare;
+
+/**
+ * Earliest count that the alarm is armed for. The overflow interrupt can't arm
+ * a match that is closer, before it has passed.
+ */
+#define ALARM_LEAD_COUNTS 2
+
+/**
+ * @brief Arm output compare B for the alarm, in fast PWM mode. OCR0B is double
+ * buffered then, and the written value is taken at the next overflow. So it
+ * is written in the overflow period before the alarm, and the compare
+ * interrupt is enabled in the alarm's period.
+ *
+ * An alarm that is set in its own overflow period, or has passed, can't be
+ * armed in time. It matches right after the next overflow instead, so the
+ * alarm always fires from the compare interrupt.
+ * @param now Current time, in timer0 counts.
+ */
+static inline __attribute__((always_inline)) void
+arm_alarm_buffered(uint32_t now) {
+    int32_t offset = alarm_time - (now & ~(uint32_t)0xFF);
+    uint8_t compare = (uint8_t)alarm_time;
+
+    CLEAR_BIT(TIMSK0, OCIE0B);
+
+    // Armed by a later overflow interrupt.
+    if (offset >= 2 * 256) {
+        return;
+    }
+
+    if (offset >= 256) {
+        if (compare < ALARM_LEAD_COUNTS) {
+            compare = ALARM_LEAD_COUNTS;
+        }
+        OCR0B = compare;
+        alarm_compare = compare;
+        alarm_is_buffered = 1;
+        return;
+    }
+
+    // OCR0B is in use since the start of this period. Flag of the previous
+    // value is cleared. If the match has just happened, it's cleared too, and
+    // the match is missed.
+    if (alarm_is_buffered && alarm_compare > (uint8_t)now) {
+        TIFR0 = BIT(OCF0B);
+        SET_BIT(TIMSK0, OCIE0B);
+        if (TCNT0 < alarm_compare || bit_is_set(TIFR0, OCF0B)) {
+            return;
+        }
+        CLEAR_BIT(TIMSK0, OCIE0B);
+    }
+
+    OCR0B = ALARM_LEAD_COUNTS;
+    alarm_compare = ALARM_LEAD_COUNTS;
+    alarm_is_buffered = 1;
+}
+
+/**
+ * @brief Arm output compare B for the alarm, if it is due in the current
+ * overflow period. Otherwise, it is armed by a later overflow interrupt.
+ * Interrupts should be disabled. Timer0 is in normal or fast PWM mode, see
+ * is_tick_mode(), so WGM00 is only set in fast PWM.
+ *
+ * Inlined, so that the overflow interrupt calls no function and saves only the
+ * registers it uses.
+ * @param now Current time, in timer0 counts.
+ */
+static inline __attribute__((always_inline)) void arm_alarm(uint32_t now) {
+    int32_t delta = alarm_time - now;
+    uint8_t count = (uint8_t)now;
+
+    if (bit_is_set(TCCR0A, WGM00)) {
+        arm_alarm_buffered(now);
+        return;
+    }
+
+    // Fire due alarms 2 counts later, so that the match isn't missed.
+    if (delta < ALARM_LEAD_COUNTS) {
+        delta = ALARM_LEAD_COUNTS;
+    }
+
+    if (delta > 0xFF - count) {
+        CLEAR_BIT(TIMSK0, OCIE0B);
+        return;
+    }
+
+    OCR0B = count + (uint8_t)delta;
+    TIFR0 = BIT(OCF0B);
+    SET_BIT(TIMSK0, OCIE0B);
+}
+
+/**
+ * Timer0 overflow interrupt. Counters are copied to registers, so that each
+ * volatile is loaded and stored only once. Alarm is only checked if it's set,
+ * and never fires from here.
+ */
+ISR(TIMER0_OVF_vect) {
+    uint32_t millis = tick_millis + TICK_MILLIS_PER_OVERFLOW;
+    uint32_t overflows = tick_overflows + 1;
+    uint16_t fraction = tick_fraction + TICK_FRACTION_PER_OVERFLOW;
+
+    if (fraction >= TICK_MILLISECOND_CYCLES) {
+        fraction -= TICK_MILLISECOND_CYCLES;
+        millis++;
+    }
+
+    tick_millis = millis;
+    tick_fraction = fraction;
+    tick_overflows = overflows;
+
+    if (alarm_handler) {
+        arm_alarm(overflows << 8 | TCNT0);
+    }
+}
+
+/**
+ * Timer0 output compare B interrupt, only enabled for the alarm. Calls the
+ * alarm handler and clears the alarm.
+ */
+ISR(TIMER0_COMPB_vect) {
+    void (*handler)(void) = alarm_handler;
+
+    CLEAR_BIT(TIMSK0, OCIE0B);
+    alarm_handler = NULL;
+    if (handler) {
+        handler();
+    }
+}
+
+/**
+ * @brief Whether timer0 counts 256 times between two overflows, in normal or
+ * fast PWM mode with 0xFF as the top, as the tick needs. CTC and OCR0A top
+ * modes overflow earlier, and phase correct PWM counts down too.
+ * @returns 1 if the operation mode can be used by the tick, 0 otherwise.
+ */
+static inline uint8_t is_tick_mode(void) {
+    uint8_t wgm = TCCR0A & (BIT(WGM01) | BIT(WGM00));
+
+    if (bit_is_set(TCCR0B, WGM02)) {
+        return 0;
+    }
+
+    return wgm == 0 || wgm == (BIT(WGM01) | BIT(WGM00));
+}
+
+/**
+ * @brief Start the system tick. Timer0 runs with a prescaler of 64 and its
+ * overflow interrupt counts the time. Interrupts should be enabled.
+ *
+ * Operation mode is left as is, so it should be normal or fast PWM with 0xFF
+ * as the top. Output compare units can still be used, e.g. for PWM. Mode
+ * should be set before the tick is started, and not changed afterwards.
+ * @returns hal_result_timer0_invalid_operation_mode if timer0 is in another
+ * mode, and the tick is not started. hal_result_timer0_ok otherwise.
+ */
+enum hal_result_timer0 hal_timer0_tick_init() {
+    uint8_t sreg;
+
+    if (!is_tick_mode()) {
+        return hal_result_timer0_invalid_operation_mode;
+    }
+
+    ENTER_CRITICAL(sreg);
+    tick_millis = 0;
+    tick_fraction = 0;
+    tick_overflows = 0;
+    alarm_handler = NULL;
+
+    TCNT0 = 0;
+    TIFR0 = BIT(TOV0);
+    SET_BIT(TIMSK0, TOIE0);
+    hal_timer0_set_clock_source(hal_timer0_prescaler_64);
+    EXIT_CRITICAL(sreg);
+
+    return hal_result_timer0_ok;
+}
+
+/**
+ * @brief Get milliseconds since the tick is started. Wraps around after ~49
+ * days.
+ * @returns Milliseconds.
+ */
+uint32_t hal_timer0_tick_get_millis() {
+    uint32_t millis;
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    millis = tick_millis;
+    EXIT_CRITICAL(sreg);
+
+    return millis;
+}
+
+/**
+ * @brief Get current time in timer0 counts, with interrupts disabled.
+ * */
+static inline uint32_t get_counts(void) {
+    uint32_t overflows;
+    uint8_t count;
+
+    overflows = tick_overflows;
+    count = TCNT0;
+
+    // Counter might wrap between the two reads. Then the count is still at
+    // the top, and the new flag belongs to the next count.
+    if (bit_is_set(TIFR0, TOV0) && count < 0xFF) {
+        overflows++;
+    }
+
+    return overflows << 8 | count;
+}
+
+/**
+ * @brief Get timer0 counts since the tick is started, 64 CPU cycles each. Wraps
+ * around after ~4.7 hours at 16 MHz.
+ *
+ * An overflow that is not handled yet, because interrupts are disabled, is
+ * taken from the TOV0 flag.
+ *
+ * @returns Timer0 counts.
+ */
+uint32_t hal_timer0_tick_get_counts() {
+    uint32_t counts;
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    counts = get_counts();
+    EXIT_CRITICAL(sreg);
+
+    return counts;
+}
+
+/**
+ * @brief Get microseconds since the tick is started, with the resolution of a
+ * timer0 count (4 us at 16 MHz). Wraps around after ~71 minutes at 16 MHz.
+ *
+ * @returns Microseconds.
+ */
+uint32_t hal_timer0_tick_get_micros() {
+#if 64 % TICK_MICROSECOND_CYCLES == 0
+    return hal_timer0_tick_get_counts() * (64 / TICK_MICROSECOND_CYCLES);
+#else
+    return hal_timer0_tick_get_counts() * 64 / TICK_MICROSECOND_CYCLES;
+#endif
+}
+
+/**
+ * @brief Advance the tick by the time that timer0 was stopped for, e.g. in a
+ * sleep mode that stops its clock. The counter is moved forward too, so an
+ * alarm that is due fires as soon as possible.
+ *
+ * @param counts Time to add, in timer0 counts. Up to ~4 minutes at once.
+ */
+void hal_timer0_tick_advance(uint32_t counts) {
+    uint32_t overflows, cycles;
+    uint16_t count;
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    overflows = counts >> 8;
+    count = TCNT0 + (uint8_t)counts;
+    if (count > 0xFF) {
+        overflows++;
+    }
+    TCNT0 = (uint8_t)count;
+
+    // A division is cheaper than adding each overflow, for long sleeps.
+    cycles = overflows * TICK_OVERFLOW_CYCLES + tick_fraction;
+    tick_millis += cycles / TICK_MILLISECOND_CYCLES;
+    tick_fraction = cycles % TICK_MILLISECOND_CYCLES;
+    tick_overflows += overflows;
+
+    // Counter is moved without an overflow, so a buffered OCR0B isn't taken.
+    if (alarm_handler) {
+        alarm_is_buffered = 0;
+        arm_alarm(get_counts());
+    }
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Set the alarm, which calls a handler from the timer0 output compare B
+ * interrupt, at the given time. Overflow interrupt arms the compare unit only
+ * in the overflow period of the alarm, so the compare interrupt runs only when
+ * the alarm fires. Replaces the previous alarm.
+ *
+ * Output compare B is used by the alarm, so OC0B can't be used for PWM at the
+ * same time. In fast PWM mode, OCR0B is double buffered, so an alarm that is
+ * set in its own overflow period fires right after the next overflow, up to
+ * 256 counts late.
+ *
+ * @param counts Time of the alarm, in timer0 counts. If it has passed, alarm
+ * fires as soon as possible.
+ * @param handler Called when the alarm fires, with interrupts disabled.
+ * @returns hal_result_timer0_invalid_operation_mode if the operation mode is
+ * changed to one that the tick can't use, and the alarm is not set.
+ * hal_result_timer0_ok otherwise.
+ */
+enum hal_result_timer0 hal_timer0_tick_set_alarm(uint32_t counts,
+                                                 void (*handler)(void)) {
+    uint8_t sreg;
+
+    if (!is_tick_mode()) {
+        return hal_result_timer0_invalid_operation_mode;
+    }
+
+    ENTER_CRITICAL(sreg);
+    alarm_time = counts;
+    alarm_handler = handler;
+    alarm_is_buffered = 0;
+    arm_alarm(get_counts());
+    EXIT_CRITICAL(sreg);
+
+    return hal_result_timer0_ok;
+}
+
+/**
+ * @brief Cancel the alarm, if it's set.
+ */
+void hal_timer0_tick_cancel_alarm() {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    alarm_handler = NULL;
+    CLEAR_BIT(TIMSK0, OCIE0B);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Get the time of the alarm, if it's set.
+ * @param counts Set to the time of the alarm, in timer0 counts.
+ * @returns 1 if the alarm is set, 0 otherwise.
+ */
+uint8_t hal_timer0_tick_get_alarm(uint32_t *counts) {
+    uint8_t is_set;
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    is_set = alarm_handler != NULL;
+    *counts = alarm_time;
+    EXIT_CRITICAL(sreg);
+
+    return is_set;
+}
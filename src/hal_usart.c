@@ -10,12 +10,29 @@
 #include "hal_usart.h"
 #include "hal_internals.h"
 #include <avr/io.h>
+#include <avr/pgmspace.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef usart_init
+#undef usart_spi_init
+#undef usart_format_hex
+#undef usart_format_fixed
 
 #ifndef F_CPU
 #warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
 #define F_CPU 16000000UL
 #endif // F_CPU
 
+/**
+ * Pin number of the XCK0 clock pin, in port D.
+ */
+#define USART_XCK0_PIN 4
+
+/**
+ * Pin number of the RXD0 receive pin, in port D.
+ */
+#define USART_RXD0_PIN 0
+
 /**
  * Sets mode of the USART.
  *
@@ -44,9 +61,12 @@ static inline uint8_t set_mode(enum usart_mode mode) {
         break;
     case usart_mode_synchronous_master:
         prescaler = 2;
-        CLEAR_BIT(UCSR0C, UMSEL00);
-        SET_BIT(UCSR0C, UMSEL01);
+        SET_BIT(UCSR0C, UMSEL00);
+        CLEAR_BIT(UCSR0C, UMSEL01);
         CLEAR_BIT(UCSR0A, U2X0);
+
+        // Master drives the clock on XCK0 (PD4).
+        SET_BIT(DDRD, USART_XCK0_PIN);
         break;
     }
 
@@ -84,8 +104,7 @@ static inline void set_parity(enum usart_parity parity) {
  * @returns `usart_error` if illegal stop bits, `usart_success` otherwise.
  * */
 static inline enum usart_result set_stop_bits(uint8_t stop_bits) {
-    if (stop_bits > 2)
-        return usart_error;
+    CHECK_ARGUMENT(stop_bits > 2, usart_error);
 
     if (stop_bits == 1) {
         CLEAR_BIT(UCSR0C, USBS0);
@@ -104,8 +123,7 @@ static inline enum usart_result set_stop_bits(uint8_t stop_bits) {
  * @returns `usart_error` if illegal data bits, `usart_success` otherwise.
  * */
 static inline enum usart_result set_data_bits(uint8_t data_bits) {
-    if (data_bits >= 10 || data_bits <= 4)
-        return usart_error;
+    CHECK_ARGUMENT(data_bits >= 10 || data_bits <= 4, usart_error);
 
     switch (data_bits) {
     case 5:
@@ -139,7 +157,13 @@ static inline enum usart_result set_baud_rate(uint32_t baud_rate,
                                               uint8_t prescaler) {
     uint16_t baud_rate_register;
 
-    baud_rate_register = F_CPU / prescaler / baud_rate - 1;
+    // Set by USART_SET_BAUD_RATE() instead.
+    if (baud_rate == 0) {
+        return usart_success;
+    }
+
+    // Round to the nearest register value, instead of truncating.
+    baud_rate_register = (F_CPU / prescaler + baud_rate / 2) / baud_rate - 1;
 
     UBRR0H = (baud_rate_register & 0xFF00) >> 8;
     UBRR0L = baud_rate_register & 0xFF;
@@ -208,6 +232,9 @@ end:
  * */
 enum usart_result usart_transmit(struct usart_t *usart, uint8_t *data,
                                  uint16_t len) {
+    // There is a single USART, settings don't change how data is written.
+    (void)usart;
+
     for (uint16_t i = 0; i < len; i++) {
         // Wait till' any ongoing transfer is complete.
         loop_until_bit_is_set(UCSR0A, UDRE0);
@@ -219,24 +246,564 @@ enum usart_result usart_transmit(struct usart_t *usart, uint8_t *data,
     return usart_success;
 }
 
+/**
+ * @brief Transmit data from program memory over USART, without copying it to
+ * RAM.
+ * @param data Data in program memory (`PROGMEM`).
+ * @param len Data length.
+ * */
+enum usart_result usart_transmit_P(const uint8_t *data, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        // Wait till' any ongoing transfer is complete.
+        loop_until_bit_is_set(UCSR0A, UDRE0);
+
+        UDR0 = pgm_read_byte(&data[i]);
+    }
+
+    return usart_success;
+}
+
+/**
+ * @brief Transmit multiple segments over USART, one after another, without
+ * assembling them into a single buffer.
+ * @param segments Segments to be transmitted, each from RAM or program memory.
+ * @param count Segment count.
+ * */
+enum usart_result usart_transmit_segments(const struct usart_segment *segments,
+                                          uint8_t count) {
+    const struct usart_segment *segment;
+
+    for (segment = segments; segment < segments + count; segment++) {
+        if (segment->is_progmem) {
+            usart_transmit_P(segment->data, segment->len);
+            continue;
+        }
+
+        for (uint16_t i = 0; i < segment->len; i++) {
+            // Wait till' any ongoing transfer is complete.
+            loop_until_bit_is_set(UCSR0A, UDRE0);
+
+            UDR0 = segment->data[i];
+        }
+    }
+
+    return usart_success;
+}
+
 /**
  * @brief Receive data over USART.
  * @param usart USART struct.
  * @param data Data buffer that will hold read data from USART buffer.
  * @param len Data buffer length.
+ *
+ * @returns Stops at the first byte with an error and returns that error. That
+ * byte is still written to `data`.
  * */
 enum usart_result usart_receive(struct usart_t *usart, uint8_t *data,
                                 uint16_t len) {
-    for (uint16_t i = 0; i < len; i++) {
-        // Wait till' any ongoing transfer is complete.
-        loop_until_bit_is_set(UCSR0A, UDRE0);
+    uint8_t status;
+
+    // There is a single USART, settings don't change how data is read.
+    (void)usart;
 
+    for (uint16_t i = 0; i < len; i++) {
         // Wait till' data is received.
         loop_until_bit_is_set(UCSR0A, RXC0);
 
+        // Error flags are valid until the data register is read.
+        status = UCSR0A;
+
         // Read data from USART data register.
         data[i] = UDR0;
+
+        if (status & BIT(FE0)) {
+            return usart_error_framing;
+        }
+        if (status & BIT(UPE0)) {
+            return usart_error_parity;
+        }
+        if (status & BIT(DOR0)) {
+            return usart_error_overrun;
+        }
     }
 
     return usart_success;
 }
+
+/*******************************************************************************
+ * Master SPI mode (MSPIM).
+ ******************************************************************************/
+
+/**
+ * @brief Initialize USART as an SPI master. Clock is output on XCK0 (PD4),
+ * data on TXD0 (PD1) and input is read from RXD0 (PD0). Chip select pins
+ * should be driven by the application.
+ *
+ * Clock rate is the highest one that doesn't exceed the requested rate, up to
+ * F_CPU / 2.
+ *
+ * @param spi SPI settings.
+ * */
+enum usart_result usart_spi_init(struct usart_spi_t *spi) {
+    uint32_t divisor;
+    uint8_t control;
+
+    CHECK_ARGUMENT(spi->clock_rate == 0, usart_error);
+    CHECK_ARGUMENT(spi->mode > usart_spi_mode_3, usart_error);
+
+    // Clock rate is F_CPU / (2 * (UBRR0 + 1)). Round divisor up.
+    divisor = (F_CPU / 2 + spi->clock_rate - 1) / spi->clock_rate;
+    if (divisor > 4096) {
+        divisor = 4096;
+    }
+
+    // Baud rate register should be 0 while enabling the transmitter.
+    UBRR0H = 0;
+    UBRR0L = 0;
+
+    SET_BIT(DDRD, USART_XCK0_PIN);
+
+    // Mode 1 and 3 sample on the trailing edge, mode 2 and 3 idle high.
+    control = BIT(UMSEL01) | BIT(UMSEL00);
+    if (spi->mode & 1) {
+        SET_BIT(control, UCPHA0);
+    }
+    if (spi->mode & 2) {
+        SET_BIT(control, UCPOL0);
+    }
+    if (spi->is_lsb_first) {
+        SET_BIT(control, UDORD0);
+    }
+    UCSR0C = control;
+    UCSR0B = BIT(RXEN0) | BIT(TXEN0);
+
+    UBRR0H = (uint8_t)((divisor - 1) >> 8);
+    UBRR0L = (uint8_t)(divisor - 1);
+
+    return usart_success;
+}
+
+/**
+ * @brief Transfer a block in both directions, in SPI master mode.
+ *
+ * Transmit buffer is kept up to 2 bytes ahead of the receiver, which is the
+ * depth of the receive buffer. So that the next byte is always ready to be
+ * shifted out, without a gap between bytes.
+ *
+ * @param tx Bytes to be transmitted. If NULL, 0xFF is transmitted.
+ * @param rx Buffer for the received bytes. If NULL, they are discarded. Can be
+ * the same as `tx`.
+ * @param len Transfer length.
+ * */
+enum usart_result usart_spi_transfer(const uint8_t *tx, uint8_t *rx,
+                                     uint16_t len) {
+    uint16_t tx_index, rx_index;
+    uint8_t data;
+
+    // Drop any stale received byte.
+    while (bit_is_set(UCSR0A, RXC0)) {
+        data = UDR0;
+    }
+
+    tx_index = 0;
+    rx_index = 0;
+    while (rx_index < len) {
+        if (tx_index < len && (uint16_t)(tx_index - rx_index) < 2 &&
+            bit_is_set(UCSR0A, UDRE0)) {
+            UDR0 = tx ? tx[tx_index] : 0xFF;
+            tx_index++;
+        }
+
+        if (bit_is_set(UCSR0A, RXC0)) {
+            data = UDR0;
+            if (rx) {
+                rx[rx_index] = data;
+            }
+            rx_index++;
+        }
+    }
+
+    return usart_success;
+}
+
+/*******************************************************************************
+ * Automatic baud rate detection.
+ ******************************************************************************/
+
+/**
+ * Timer1 overflows since the start of the detection. High word of the time.
+ * */
+static uint16_t autobaud_overflows;
+
+/**
+ * Timer1 count at the last poll, to find out when it wraps around.
+ * */
+static uint16_t autobaud_count;
+
+/**
+ * Timer1 overflows until the timeout. 0 if disabled.
+ * */
+static uint16_t autobaud_timeout;
+
+/**
+ * @brief Read timer1, and count an overflow if it has wrapped around since the
+ * last poll. Overflow flag is left alone, it belongs to the application.
+ * @returns 1 if the timeout is reached, 0 otherwise.
+ * */
+static inline uint8_t autobaud_poll(void) {
+    uint16_t count;
+
+    count = TCNT1;
+    if (count < autobaud_count) {
+        autobaud_overflows++;
+    }
+    autobaud_count = count;
+
+    return autobaud_timeout != 0 && autobaud_overflows >= autobaud_timeout;
+}
+
+/**
+ * @brief Wait until the receive pin is at the given level.
+ * @param level `BIT(USART_RXD0_PIN)` for high, 0 for low.
+ * @returns 1 if the level is reached, 0 on a timeout.
+ * */
+static inline uint8_t autobaud_wait(uint8_t level) {
+    while ((PIND & BIT(USART_RXD0_PIN)) != level) {
+        if (autobaud_poll()) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Wait for the falling edge of the start bit. Interrupts are enabled
+ * between the polls, as they were before the detection, and are left disabled
+ * once the edge is found.
+ * @param sreg Status register from before the detection.
+ * @returns 1 if the edge is found, 0 on a timeout.
+ * */
+static inline uint8_t autobaud_wait_start(uint8_t sreg) {
+    for (;;) {
+        cli();
+        if (bit_is_clear(PIND, USART_RXD0_PIN)) {
+            return 1;
+        }
+        EXIT_CRITICAL(sreg);
+
+        if (autobaud_poll()) {
+            return 0;
+        }
+    }
+}
+
+/**
+ * @brief Get the time since the start of the detection, in CPU cycles.
+ * */
+static inline uint32_t autobaud_time(void) {
+    autobaud_poll();
+
+    return ((uint32_t)autobaud_overflows << 16) | autobaud_count;
+}
+
+/**
+ * @brief Get the difference between the measured and the selected sync time.
+ * */
+static inline uint16_t autobaud_error(uint32_t sync, uint32_t selected) {
+    return selected > sync ? selected - sync : sync - selected;
+}
+
+/**
+ * @brief Detect the baud rate from a sync byte (0x55) that is sent to the
+ * receive pin (RXD0, PD0), and set the baud rate registers for it.
+ *
+ * 0x55 has a falling edge every other bit, starting with the start bit. The
+ * time between the first and fifth falling edges is 8 bits long, and gives the
+ * bit time. It is measured in CPU cycles by timer1, which is borrowed and
+ * restored afterwards, including its counter and pending flags. Normal or
+ * double speed mode is selected, whichever is more accurate.
+ *
+ * Interrupts are disabled only from the start bit to the fifth falling edge,
+ * so that they don't delay the edges. An interrupt that runs longer than a
+ * timer1 overflow (65536 cycles) while waiting for the start bit makes the
+ * timeout longer. USART should be initialized beforehand, the receiver is
+ * disabled during the detection.
+ *
+ * @param timeout_ms Timeout in milliseconds. 0 to wait forever.
+ * @param baud_rate Detected baud rate in bps. Can be NULL.
+ *
+ * @returns `usart_error_timeout` on a timeout, `usart_error` if the sync byte
+ * is invalid or the baud rate is out of range, `usart_success` otherwise.
+ * */
+enum usart_result usart_detect_baud_rate(uint16_t timeout_ms,
+                                         uint32_t *baud_rate) {
+    enum usart_result result;
+    uint32_t start, start_bit, sync;
+    uint16_t normal, double_speed, normal_error, double_speed_error, ubrr,
+        timer_count;
+    uint8_t timer_a, timer_b, timer_mask, timer_flags, control, speed, edge,
+        sreg;
+
+    ENTER_CRITICAL(sreg);
+
+    control = UCSR0B;
+    CLEAR_BIT(UCSR0B, RXEN0);
+
+    // Run timer1 at F_CPU, without interrupts.
+    timer_a = TCCR1A;
+    timer_b = TCCR1B;
+    timer_mask = TIMSK1;
+    timer_flags = TIFR1;
+    TIMSK1 = 0;
+    TCCR1B = 0;
+    timer_count = TCNT1;
+    TCCR1A = 0;
+    TCNT1 = 0;
+    TCCR1B = BIT(CS10);
+
+    EXIT_CRITICAL(sreg);
+
+    autobaud_overflows = 0;
+    autobaud_count = 0;
+    autobaud_timeout = 0;
+    if (timeout_ms != 0) {
+        autobaud_timeout =
+            ((uint32_t)timeout_ms * (F_CPU / 1000) + 0xFFFF) >> 16;
+    }
+
+    result = usart_error_timeout;
+
+    // Line should be idle before the start bit.
+    if (!autobaud_wait(BIT(USART_RXD0_PIN)) || !autobaud_wait_start(sreg)) {
+        goto restore;
+    }
+    start = autobaud_time();
+
+    if (!autobaud_wait(BIT(USART_RXD0_PIN))) {
+        goto restore;
+    }
+    start_bit = autobaud_time() - start;
+
+    for (edge = 0; edge < 4; edge++) {
+        if (!autobaud_wait(0)) {
+            goto restore;
+        }
+        sync = autobaud_time();
+        if (edge < 3 && !autobaud_wait(BIT(USART_RXD0_PIN))) {
+            goto restore;
+        }
+    }
+    sync -= start;
+
+    EXIT_CRITICAL(sreg);
+
+    result = usart_error;
+
+    // Start bit should be 1/8 of the sync time, within 25%.
+    if (start_bit * 8 < sync - sync / 4 || start_bit * 8 > sync + sync / 4) {
+        goto restore;
+    }
+
+    // Sync time is 8 bits, so 128 cycles per UBRR0 step in normal mode and 64
+    // in double speed mode.
+    if (sync < 64 || sync > 4096UL * 128) {
+        goto restore;
+    }
+    normal = (sync + 64) >> 7;
+    double_speed = (sync + 32) >> 6;
+    if (double_speed > 4096) {
+        double_speed = 4096;
+    }
+    normal_error = autobaud_error(sync, (uint32_t)normal << 7);
+    double_speed_error = autobaud_error(sync, (uint32_t)double_speed << 6);
+
+    if (double_speed_error < normal_error) {
+        speed = BIT(U2X0);
+        ubrr = double_speed - 1;
+    } else {
+        speed = 0;
+        ubrr = normal - 1;
+    }
+
+    if (baud_rate) {
+        *baud_rate = (F_CPU * 8 + sync / 2) / sync;
+    }
+    result = usart_success;
+
+restore:
+    // Interrupts may still be disabled, after a timeout during the sync byte.
+    cli();
+
+    TCCR1B = 0;
+    TCNT1 = timer_count;
+    TCCR1A = timer_a;
+    TCCR1B = timer_b;
+
+    // Only the flags that are raised while timer1 was borrowed are cleared,
+    // pending ones of the application are kept.
+    timer_flags = TIFR1 & ~timer_flags;
+    if (timer_flags) {
+        TIFR1 = timer_flags;
+    }
+    TIMSK1 = timer_mask;
+
+    // Transmit complete flag is cleared by writing 1, so only the control
+    // bits are written back.
+    if (result == usart_success) {
+        UCSR0A = (UCSR0A & BIT(MPCM0)) | speed;
+        UBRR0H = (uint8_t)(ubrr >> 8);
+        UBRR0L = (uint8_t)ubrr;
+    }
+
+    // Re-enabling the receiver drops the sync byte. Other control bits may
+    // have been changed by the interrupts meanwhile.
+    if (control & BIT(RXEN0)) {
+        SET_BIT(UCSR0B, RXEN0);
+    }
+
+    EXIT_CRITICAL(sreg);
+
+    return result;
+}
+
+/*******************************************************************************
+ * Formatting.
+ ******************************************************************************/
+
+/**
+ * Powers of ten, that are subtracted to find each decimal digit.
+ * */
+static const uint32_t powers_of_ten[10] PROGMEM = {
+    1000000000, 100000000, 10000000, 1000000, 100000,
+    10000,      1000,      100,      10,      1,
+};
+
+/**
+ * @brief Write decimal digits of a value, without a division. Each digit is
+ * found by subtracting its power of ten, up to 9 times.
+ * @param buffer Output buffer.
+ * @param value Value to be written.
+ * @param min_digits Minimum number of digits, padded with leading zeros.
+ * @returns Number of written chars.
+ * */
+static uint8_t format_digits(char *buffer, uint32_t value,
+                             uint8_t min_digits) {
+    uint32_t power;
+    uint8_t i, length;
+    char digit;
+
+    length = 0;
+    for (i = 0; i < 10; i++) {
+        power = pgm_read_dword(&powers_of_ten[i]);
+
+        digit = '0';
+        while (value >= power) {
+            value -= power;
+            digit++;
+        }
+
+        // Skip leading zeros, but keep the last digit.
+        if (length > 0 || digit != '0' || 10 - i <= min_digits) {
+            buffer[length++] = digit;
+        }
+    }
+
+    return length;
+}
+
+/**
+ * @brief Format an unsigned integer as decimal.
+ * @param buffer Output buffer, at least `USART_FORMAT_BUFFER_SIZE` chars.
+ * @param value Value to be formatted.
+ * @returns Length of the string, excluding the null terminator.
+ * */
+uint8_t usart_format_uint(char *buffer, uint32_t value) {
+    uint8_t length;
+
+    length = format_digits(buffer, value, 1);
+    buffer[length] = '\0';
+
+    return length;
+}
+
+/**
+ * @brief Format a signed integer as decimal.
+ * @param buffer Output buffer, at least `USART_FORMAT_BUFFER_SIZE` chars.
+ * @param value Value to be formatted.
+ * @returns Length of the string, excluding the null terminator.
+ * */
+uint8_t usart_format_int(char *buffer, int32_t value) {
+    if (value < 0) {
+        buffer[0] = '-';
+        return usart_format_uint(buffer + 1, 0 - (uint32_t)value) + 1;
+    }
+
+    return usart_format_uint(buffer, value);
+}
+
+/**
+ * @brief Format an unsigned integer as upper case hexadecimal, without a
+ * prefix.
+ * @param buffer Output buffer, at least `USART_FORMAT_BUFFER_SIZE` chars.
+ * @param value Value to be formatted.
+ * @param digits Number of digits, between 1 and 8. Value is truncated to
+ * them.
+ * @returns Length of the string, excluding the null terminator. 0 if `digits`
+ * is invalid.
+ * */
+uint8_t usart_format_hex(char *buffer, uint32_t value, uint8_t digits) {
+    uint8_t i, nibble;
+
+    CHECK_ARGUMENT(digits == 0 || digits > 8, 0);
+
+    for (i = digits; i > 0; i--) {
+        nibble = value & 0x0F;
+        buffer[i - 1] = nibble < 10 ? '0' + nibble : 'A' - 10 + nibble;
+        value >>= 4;
+    }
+    buffer[digits] = '\0';
+
+    return digits;
+}
+
+/**
+ * @brief Format a fixed-point value as decimal, e.g. 12345 with 2 fraction
+ * digits is formatted as "123.45".
+ * @param buffer Output buffer, at least `USART_FORMAT_BUFFER_SIZE` chars.
+ * @param value Value, scaled by 10 to the power of `fraction_digits`.
+ * @param fraction_digits Number of digits after the decimal point, up to 9.
+ * @returns Length of the string, excluding the null terminator. 0 if
+ * `fraction_digits` is invalid.
+ * */
+uint8_t usart_format_fixed(char *buffer, int32_t value,
+                           uint8_t fraction_digits) {
+    uint32_t magnitude;
+    uint8_t length, sign, i;
+
+    CHECK_ARGUMENT(fraction_digits > 9, 0);
+
+    sign = 0;
+    magnitude = value;
+    if (value < 0) {
+        buffer[0] = '-';
+        sign = 1;
+        magnitude = 0 - (uint32_t)value;
+    }
+
+    // At least one digit before the decimal point.
+    length = format_digits(buffer + sign, magnitude, fraction_digits + 1);
+    length += sign;
+
+    // Shift the fraction to make room for the decimal point.
+    if (fraction_digits > 0) {
+        for (i = length; i > length - fraction_digits; i--) {
+            buffer[i] = buffer[i - 1];
+        }
+        buffer[i] = '.';
+        length++;
+    }
+    buffer[length] = '\0';
+
+    return length;
+}
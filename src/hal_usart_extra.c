@@ -13,7 +13,7 @@
 #include <stdio.h>
 
 /*******************************************************************************
- * Standart I/O support.
+ * Standard I/O support.
  ******************************************************************************/
 
 /**
@@ -36,26 +36,63 @@ static int usart_stdio_transmit_char(char c, FILE *stream) {
     return 0;
 }
 
+/**
+ * @brief Queue a char to the interrupt driven transmitter for stdio, without
+ * blocking.
+ * @param c Char to queue.
+ * @param stream I/O stream (only here cause it's necessary).
+ * @retval 0 if the char is queued.
+ * @retval -1 if the transmit buffer is full. Char is dropped.
+ * */
+static int usart_stdio_queue_char(char c, FILE *stream) {
+    static const uint8_t new_line[] = {'\r', '\n'};
+
+    (void)stream;
+
+    // Add cariage return character before a new line. Both are queued, or
+    // none of them, so that a line ending isn't cut.
+    if (c == '\n') {
+        if (usart_transmit_irq_free() < sizeof new_line) {
+            return -1;
+        }
+        usart_transmit_irq(new_line, sizeof new_line);
+        return 0;
+    }
+
+    if (usart_transmit_irq((const uint8_t *)&c, 1) == 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
 /**
  * @brief Receive a char on USART for stdio.
  * @param stream I/O stream (only here cause it's necessary).
  * @returns Received char.
  * */
 static int usart_stdio_receive_char(FILE *stream) {
-    // Wait till' any ongoing transfer is complete.
-    loop_until_bit_is_set(UCSR0A, UDRE0);
+    uint8_t c;
+
+    (void)stream;
 
     // Wait till' data is received.
     loop_until_bit_is_set(UCSR0A, RXC0);
 
     // Get data.
-    char c = UDR0;
+    c = UDR0;
 
     return c;
 }
 
 /**
- * @brief Initialize standart I/O stream.
+ * Standard input stream.
+ * */
+static FILE hal_stdin =
+    FDEV_SETUP_STREAM(NULL, usart_stdio_receive_char, _FDEV_SETUP_READ);
+
+/**
+ * @brief Initialize standard I/O stream.
  * */
 void usart_stdio_init() {
     // Set stdout.
@@ -64,7 +101,27 @@ void usart_stdio_init() {
     stdout = &hal_stdout;
 
     // Set stdin.
-    static FILE hal_stdin =
-        FDEV_SETUP_STREAM(NULL, usart_stdio_receive_char, _FDEV_SETUP_READ);
     stdin = &hal_stdin;
 }
+
+/**
+ * @brief Initialize standard I/O stream, with a buffered output. Output is
+ * queued to the interrupt driven transmitter, see usart_transmit_irq(). So
+ * interrupts should be enabled. Writing never blocks, chars that don't fit
+ * into the transmit buffer are dropped, and the write fails (see `ferror()`).
+ * */
+void usart_stdio_init_buffered() {
+    // Set stdout.
+    static FILE hal_stdout =
+        FDEV_SETUP_STREAM(usart_stdio_queue_char, NULL, _FDEV_SETUP_WRITE);
+    stdout = &hal_stdout;
+
+    // Set stdin.
+    stdin = &hal_stdin;
+}
+
+/**
+ * @brief Block until the buffered output is transmitted. See
+ * usart_stdio_init_buffered().
+ * */
+void usart_stdio_flush() { usart_transmit_irq_flush(); }
@@ -0,0 +1,503 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief Interrupt driven, non-blocking USART receive functions for ATmega328P
+ * HAL driver. Transmit functions are in hal_usart_irq_tx.c, so that their
+ * interrupts are linked only if they are used.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_usart.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <string.h>
+
+#if USART_RX_BUFFER_SIZE < 2 || USART_RX_BUFFER_SIZE > 128 ||                  \
+    (USART_RX_BUFFER_SIZE & (USART_RX_BUFFER_SIZE - 1))
+#error "USART_RX_BUFFER_SIZE should be a power of 2, between 2 and 128."
+#endif
+
+static void receive_frame_byte(uint8_t data, uint8_t is_invalid,
+                               uint8_t is_overrun);
+
+/*******************************************************************************
+ * Receive.
+ ******************************************************************************/
+
+/**
+ * Received bytes, waiting to be read. Indexes are free running, like the
+ * transmit buffer.
+ */
+static uint8_t rx_buffer[USART_RX_BUFFER_SIZE];
+
+/**
+ * Where the next byte is written to. Only changed by the interrupt.
+ */
+static volatile uint8_t rx_head;
+
+/**
+ * Where the next byte is read from. Only changed by the application.
+ */
+static volatile uint8_t rx_tail;
+
+/**
+ * Error counters, since they were last read.
+ */
+static volatile struct usart_errors rx_errors;
+
+/**
+ * Framing of the received bytes. If set, bytes are passed to the frame decoder
+ * instead of the buffer.
+ */
+static volatile enum usart_framing rx_framing;
+
+/**
+ * Address of this node in multi-processor communication mode, and if it's
+ * enabled.
+ */
+static volatile uint8_t rx_address;
+static volatile uint8_t rx_is_addressed;
+
+/**
+ * Increment an error counter, without wrapping around.
+ */
+#define COUNT_ERROR(counter)                                                   \
+    do {                                                                       \
+        if ((counter) != UINT8_MAX) {                                          \
+            (counter)++;                                                       \
+        }                                                                      \
+    } while (0)
+
+/**
+ * USART receive complete interrupt. Checks error flags of the received byte
+ * and moves it to the buffer.
+ */
+ISR(USART_RX_vect) {
+    uint8_t status, control, data, head;
+
+    // Error flags and 9th bit are valid until the data register is read.
+    status = UCSR0A;
+    control = UCSR0B;
+    data = UDR0;
+
+    // Data overrun means that bytes before this one were lost, this one is
+    // still valid.
+    if (status & BIT(DOR0)) {
+        COUNT_ERROR(rx_errors.overrun);
+    }
+    if (status & BIT(FE0)) {
+        COUNT_ERROR(rx_errors.framing);
+    } else if (status & BIT(UPE0)) {
+        COUNT_ERROR(rx_errors.parity);
+    }
+
+    // In multi-processor communication mode, hardware ignores data frames
+    // until an address frame with this node's address is received. Then
+    // data frames are received, until another address frame.
+    if (rx_is_addressed && (control & BIT(RXB80))) {
+        if (!(status & (BIT(FE0) | BIT(UPE0)))) {
+            UCSR0A = (status & BIT(U2X0)) |
+                     (data == rx_address ? 0 : BIT(MPCM0));
+        }
+        return;
+    }
+
+    // A lost or an invalid byte corrupts the whole frame.
+    if (rx_framing != usart_framing_none) {
+        receive_frame_byte(data, status & (BIT(FE0) | BIT(UPE0)),
+                           status & BIT(DOR0));
+        return;
+    }
+
+    if (status & (BIT(FE0) | BIT(UPE0))) {
+        return;
+    }
+
+    head = rx_head;
+    if ((uint8_t)(head - rx_tail) == USART_RX_BUFFER_SIZE) {
+        COUNT_ERROR(rx_errors.buffer_overrun);
+        return;
+    }
+
+    rx_buffer[head & (USART_RX_BUFFER_SIZE - 1)] = data;
+    rx_head = head + 1;
+}
+
+/**
+ * @brief Start receiving to the buffer, with the receive complete interrupt.
+ * Receiver should be enabled by usart_init() beforehand.
+ * */
+void usart_receive_irq_enable() {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    SET_BIT(UCSR0B, RXCIE0);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Stop receiving to the buffer. Already received bytes can still be
+ * read.
+ * */
+void usart_receive_irq_disable() {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    CLEAR_BIT(UCSR0B, RXCIE0);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Enable multi-processor communication mode, so that only data frames
+ * addressed to this node are received. Other frames are filtered by hardware,
+ * without an interrupt. USART should be initialized with 9 data bits. Address
+ * frames are not moved to the buffer.
+ *
+ * @param address Address of this node.
+ * */
+void usart_receive_irq_set_address(uint8_t address) {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    rx_address = address;
+    rx_is_addressed = 1;
+
+    // Wait for an address frame. Error flags should be written as 0.
+    UCSR0A = (UCSR0A & BIT(U2X0)) | BIT(MPCM0);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Disable multi-processor communication mode, so that all of the
+ * frames are received.
+ * */
+void usart_receive_irq_clear_address() {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    rx_is_addressed = 0;
+    UCSR0A &= BIT(U2X0);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Get number of received bytes, waiting to be read.
+ * */
+uint8_t usart_receive_irq_available() { return rx_head - rx_tail; }
+
+/**
+ * @brief Read a received byte, without blocking.
+ *
+ * @param data Read byte.
+ *
+ * @returns `usart_error_underrun` if there isn't any byte to be read,
+ * `usart_success` otherwise.
+ * */
+enum usart_result usart_receive_irq_read(uint8_t *data) {
+    uint8_t tail = rx_tail;
+
+    if (tail == rx_head) {
+        return usart_error_underrun;
+    }
+
+    *data = rx_buffer[tail & (USART_RX_BUFFER_SIZE - 1)];
+    rx_tail = tail + 1;
+
+    return usart_success;
+}
+
+/**
+ * @brief Read multiple received bytes, without blocking. Bytes are copied in
+ * at most 2 contiguous spans, as the buffer might wrap around.
+ *
+ * @param data Buffer to copy bytes to.
+ * @param len Maximum number of bytes to be read.
+ *
+ * @returns Number of read bytes.
+ * */
+uint8_t usart_receive_irq_read_bulk(uint8_t *data, uint8_t len) {
+    uint8_t tail, available, index, span;
+
+    tail = rx_tail;
+    available = rx_head - tail;
+    if (len > available) {
+        len = available;
+    }
+
+    // Copy until the end of the buffer, then the rest from the start.
+    index = tail & (USART_RX_BUFFER_SIZE - 1);
+    span = USART_RX_BUFFER_SIZE - index;
+    if (span > len) {
+        span = len;
+    }
+    memcpy(data, &rx_buffer[index], span);
+    memcpy(data + span, rx_buffer, len - span);
+
+    rx_tail = tail + len;
+
+    return len;
+}
+
+/**
+ * @brief Get error counters and reset them. Counters stop at 255.
+ *
+ * @param errors Error counters since the last call.
+ * */
+void usart_receive_irq_get_errors(struct usart_errors *errors) {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    errors->overrun = rx_errors.overrun;
+    errors->framing = rx_errors.framing;
+    errors->parity = rx_errors.parity;
+    errors->buffer_overrun = rx_errors.buffer_overrun;
+    errors->frame = rx_errors.frame;
+    rx_errors.overrun = 0;
+    rx_errors.framing = 0;
+    rx_errors.parity = 0;
+    rx_errors.buffer_overrun = 0;
+    rx_errors.frame = 0;
+    EXIT_CRITICAL(sreg);
+}
+
+/*******************************************************************************
+ * Framing.
+ ******************************************************************************/
+
+/**
+ * COBS frame delimiter.
+ */
+#define COBS_END 0x00
+
+/**
+ * SLIP special characters.
+ */
+#define SLIP_END 0xC0
+#define SLIP_ESC 0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+/**
+ * Frame being decoded and the published one. A frame is decoded into
+ * `frame_buffers[frame_active]`, while the other one might be held by the
+ * application.
+ */
+static uint8_t *frame_buffers[2];
+static uint8_t frame_size;
+static uint8_t frame_active;
+static uint8_t frame_length;
+static uint8_t frame_ready_length;
+static volatile uint8_t frame_is_ready;
+
+/**
+ * CRC of the decoded bytes, including the received CRC.
+ */
+static uint16_t frame_crc;
+
+/**
+ * Set if the frame being decoded is corrupt. Rest of it is ignored until the
+ * next delimiter.
+ */
+static uint8_t frame_is_corrupt;
+
+/**
+ * COBS: Bytes left in the current block, and if the block ends with an
+ * implicit zero.
+ */
+static uint8_t cobs_remaining;
+static uint8_t cobs_has_zero;
+
+/**
+ * SLIP: Set after an escape character.
+ */
+static uint8_t slip_is_escaped;
+
+/**
+ * Update CRC-16/CCITT (polynomial 0x1021, most significant bit first) with a
+ * byte, without a table or a bit loop.
+ */
+static inline uint16_t crc16_ccitt_update(uint16_t crc, uint8_t data) {
+    uint8_t x;
+
+    x = (crc >> 8) ^ data;
+    x ^= x >> 4;
+
+    return (crc << 8) ^ ((uint16_t)x << 12) ^ ((uint16_t)x << 5) ^ x;
+}
+
+/**
+ * Start decoding a new frame.
+ */
+static void reset_frame() {
+    frame_length = 0;
+    frame_crc = 0xFFFF;
+    frame_is_corrupt = 0;
+    cobs_remaining = 0;
+    cobs_has_zero = 0;
+    slip_is_escaped = 0;
+}
+
+/**
+ * Add a decoded byte to the frame.
+ */
+static void add_frame_byte(uint8_t data) {
+    if (frame_length == frame_size) {
+        frame_is_corrupt = 1;
+        return;
+    }
+
+    frame_buffers[frame_active][frame_length++] = data;
+    frame_crc = crc16_ccitt_update(frame_crc, data);
+}
+
+/**
+ * Publish the decoded frame, if it's valid and the application released the
+ * previous one. Otherwise drop it.
+ */
+static void end_frame() {
+    // Consecutive delimiters are not frames.
+    if (frame_length == 0 && !frame_is_corrupt) {
+        return;
+    }
+
+    // CRC over the data and its own big endian CRC leaves 0.
+    if (frame_is_corrupt || frame_length < 2 || frame_crc != 0) {
+        COUNT_ERROR(rx_errors.frame);
+    } else if (frame_is_ready) {
+        COUNT_ERROR(rx_errors.buffer_overrun);
+    } else {
+        frame_ready_length = frame_length - 2;
+        frame_active ^= 1;
+        frame_is_ready = 1;
+    }
+
+    reset_frame();
+}
+
+/**
+ * Decode a received byte, called from the receive complete interrupt.
+ *
+ * @param data Received byte.
+ * @param is_invalid Non-zero, if the byte has a framing or a parity error.
+ * @param is_overrun Non-zero, if bytes were lost around this one. Byte itself
+ * is still valid, so a delimiter still ends the frame.
+ */
+static void receive_frame_byte(uint8_t data, uint8_t is_invalid,
+                               uint8_t is_overrun) {
+    if (is_invalid) {
+        frame_is_corrupt = 1;
+        return;
+    }
+    if (is_overrun) {
+        frame_is_corrupt = 1;
+    }
+
+    if (rx_framing == usart_framing_cobs) {
+        if (data == COBS_END) {
+            // A frame can only end where a block does.
+            if (cobs_remaining != 0) {
+                frame_is_corrupt = 1;
+            }
+            end_frame();
+        } else if (frame_is_corrupt) {
+            return;
+        } else if (cobs_remaining == 0) {
+            // Code byte. Zero of the previous block is added only if another
+            // block follows it.
+            if (cobs_has_zero) {
+                add_frame_byte(0);
+            }
+            cobs_remaining = data - 1;
+            cobs_has_zero = data != 0xFF;
+        } else {
+            add_frame_byte(data);
+            cobs_remaining--;
+        }
+        return;
+    }
+
+    // SLIP.
+    if (data == SLIP_END) {
+        end_frame();
+    } else if (frame_is_corrupt) {
+        return;
+    } else if (slip_is_escaped) {
+        slip_is_escaped = 0;
+        if (data == SLIP_ESC_END) {
+            add_frame_byte(SLIP_END);
+        } else if (data == SLIP_ESC_ESC) {
+            add_frame_byte(SLIP_ESC);
+        } else {
+            frame_is_corrupt = 1;
+        }
+    } else if (data == SLIP_ESC) {
+        slip_is_escaped = 1;
+    } else {
+        add_frame_byte(data);
+    }
+}
+
+/**
+ * @brief Set framing of the received bytes. If set, received bytes are
+ * decoded into frames in the receive complete interrupt, instead of being
+ * moved to the receive buffer. Each frame should end with its CRC-16/CCITT
+ * (initial value 0xFFFF), in big endian. Frames are decoded into 2 buffers in
+ * turns, so that a new frame can be received while the application processes
+ * the previous one.
+ *
+ * @param framing Framing of the received bytes. Disables framing if it's
+ * `usart_framing_none`.
+ * @param buffer_a First frame buffer.
+ * @param buffer_b Second frame buffer.
+ * @param size Size of each buffer, including the CRC.
+ * */
+void usart_receive_irq_set_framing(enum usart_framing framing,
+                                   uint8_t *buffer_a, uint8_t *buffer_b,
+                                   uint8_t size) {
+    uint8_t sreg;
+
+    ENTER_CRITICAL(sreg);
+    rx_framing = framing;
+    frame_buffers[0] = buffer_a;
+    frame_buffers[1] = buffer_b;
+    frame_size = size;
+    frame_active = 0;
+    frame_is_ready = 0;
+    reset_frame();
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Get the last received frame, without its CRC. Frame is held until
+ * it's released with usart_receive_irq_release_frame(). Any frame received
+ * meanwhile is dropped, if both of the buffers are full.
+ *
+ * @param frame Start of the frame.
+ * @param length Frame length.
+ *
+ * @returns `usart_error_underrun` if there isn't any received frame,
+ * `usart_success` otherwise.
+ * */
+enum usart_result usart_receive_irq_get_frame(const uint8_t **frame,
+                                              uint8_t *length) {
+    if (!frame_is_ready) {
+        return usart_error_underrun;
+    }
+
+    // Published frame is the one before the active one. Interrupt doesn't
+    // change them until the frame is released.
+    *frame = frame_buffers[frame_active ^ 1];
+    *length = frame_ready_length;
+
+    return usart_success;
+}
+
+/**
+ * @brief Release the frame from usart_receive_irq_get_frame(), so that its
+ * buffer can be reused.
+ * */
+void usart_receive_irq_release_frame() { frame_is_ready = 0; }
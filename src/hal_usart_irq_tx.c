@@ -0,0 +1,364 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief Interrupt driven, non-blocking USART transmit functions for
+ * ATmega328P HAL driver. Receive functions are in hal_usart_irq_rx.c, so that
+ * their interrupt is linked only if they are used.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_usart.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+// Checking wrappers of the header are for the callers only.
+#undef usart_rs485_enable
+
+#if USART_TX_BUFFER_SIZE < 2 || USART_TX_BUFFER_SIZE > 128 ||                  \
+    (USART_TX_BUFFER_SIZE & (USART_TX_BUFFER_SIZE - 1))
+#error "USART_TX_BUFFER_SIZE should be a power of 2, between 2 and 128."
+#endif
+
+static void start_transmit(void);
+
+/*******************************************************************************
+ * Transmit.
+ ******************************************************************************/
+
+/**
+ * Bytes waiting to be transmitted. Head and tail indexes are free running, and
+ * they are masked only while accessing the buffer. So that the buffer can be
+ * filled completely, without losing a slot to tell it apart from empty.
+ */
+static uint8_t tx_buffer[USART_TX_BUFFER_SIZE];
+
+/**
+ * Where the next byte is written to. Only changed by the application.
+ */
+static volatile uint8_t tx_head;
+
+/**
+ * Where the next byte is read from. Only changed by the interrupt.
+ */
+static volatile uint8_t tx_tail;
+
+/**
+ * Set when a byte is moved to the transmitter. Cleared by a flush.
+ */
+static volatile uint8_t tx_started;
+
+/**
+ * Queued bytes that are address frames, a bit for each slot of the buffer.
+ */
+static uint8_t tx_address_marks[(USART_TX_BUFFER_SIZE + 7) / 8];
+
+/**
+ * Number of queued address frames. Marks are looked at only if there is one,
+ * or if the 9th bit is still set for the last one.
+ */
+static volatile uint8_t tx_address_count;
+
+/**
+ * @brief Set the 9th bit for the byte in a slot of the buffer, if it's an
+ * address frame. Clear it otherwise.
+ */
+static inline void set_ninth_bit(uint8_t index) {
+    uint8_t *marks = &tx_address_marks[index >> 3];
+    uint8_t mask = BIT(index & 7);
+
+    if (*marks & mask) {
+        *marks &= (uint8_t)~mask;
+        tx_address_count--;
+        SET_BIT(UCSR0B, TXB80);
+    } else {
+        CLEAR_BIT(UCSR0B, TXB80);
+    }
+}
+
+/**
+ * USART data register empty interrupt. Moves the next byte from the buffer to
+ * the transmitter. Disables itself when the buffer is empty.
+ */
+ISR(USART_UDRE_vect) {
+    uint8_t tail = tx_tail;
+    uint8_t index;
+
+    if (tail == tx_head) {
+        CLEAR_BIT(UCSR0B, UDRIE0);
+        return;
+    }
+    index = tail & (USART_TX_BUFFER_SIZE - 1);
+
+    // 9th bit is taken when the byte moves to the shift register, which is
+    // not before this write, and before the next interrupt.
+    if (tx_address_count != 0 || bit_is_set(UCSR0B, TXB80)) {
+        set_ninth_bit(index);
+    }
+
+    // Clear transmit complete flag, so that a flush can wait for this byte.
+    // Error flags should be written as 0.
+    UCSR0A = (UCSR0A & (BIT(U2X0) | BIT(MPCM0))) | BIT(TXC0);
+    UDR0 = tx_buffer[index];
+    tx_tail = tail + 1;
+    tx_started = 1;
+}
+
+/**
+ * PORTx register of the RS-485 driver enable pin. NULL if RS-485 mode is
+ * disabled.
+ */
+static volatile uint8_t *rs485_port;
+
+/**
+ * Bit mask of the RS-485 driver enable pin.
+ */
+static uint8_t rs485_mask;
+
+/**
+ * USART transmit complete interrupt, only enabled in RS-485 mode. Releases
+ * the bus after the last stop bit, unless more bytes are queued.
+ */
+ISR(USART_TX_vect) {
+    if (tx_tail != tx_head) {
+        return;
+    }
+
+    *rs485_port &= (uint8_t)~rs485_mask;
+    tx_started = 0;
+}
+
+/**
+ * @brief Start the transmitter after queuing. Takes the RS-485 bus first, so
+ * that it is driven before the first start bit.
+ */
+static void start_transmit(void) {
+    uint8_t sreg;
+
+    // UCSR0B and the port are shared with the interrupts. UDRE interrupt
+    // disables itself.
+    ENTER_CRITICAL(sreg);
+    if (rs485_port) {
+        *rs485_port |= rs485_mask;
+    }
+    SET_BIT(UCSR0B, UDRIE0);
+    EXIT_CRITICAL(sreg);
+}
+
+/**
+ * @brief Queue data to be transmitted over USART, without blocking. Queued
+ * bytes are transmitted from the data register empty interrupt, so global
+ * interrupts should be enabled.
+ *
+ * Only the bytes that fit into the free space are queued. Use
+ * usart_transmit_irq_free() beforehand to queue a frame as a whole.
+ *
+ * @param data Data to be queued.
+ * @param len Data length.
+ *
+ * @returns Number of queued bytes.
+ * */
+uint16_t usart_transmit_irq(const uint8_t *data, uint16_t len) {
+    uint8_t head, free;
+    uint16_t i;
+
+    head = tx_head;
+    free = USART_TX_BUFFER_SIZE - (uint8_t)(head - tx_tail);
+    if (len > free) {
+        len = free;
+    }
+
+    for (i = 0; i < len; i++) {
+        tx_buffer[head & (USART_TX_BUFFER_SIZE - 1)] = data[i];
+        head++;
+    }
+    tx_head = head;
+
+    if (len > 0) {
+        start_transmit();
+    }
+
+    return len;
+}
+
+/**
+ * @brief Queue multiple segments to be transmitted over USART, without
+ * blocking. Segments are queued as a whole, or not at all, so that a frame is
+ * never cut. Segments are copied to the buffer directly, either from RAM or
+ * program memory.
+ *
+ * @param segments Segments to be queued.
+ * @param count Segment count.
+ *
+ * @returns `usart_error_overrun` if there isn't enough free space for all of
+ * the segments, `usart_success` otherwise.
+ * */
+enum usart_result
+usart_transmit_irq_segments(const struct usart_segment *segments,
+                            uint8_t count) {
+    const struct usart_segment *segment;
+    uint8_t head, index, span, len;
+    uint16_t total;
+
+    total = 0;
+    for (segment = segments; segment < segments + count; segment++) {
+        total += segment->len;
+    }
+
+    head = tx_head;
+    if (total > (uint8_t)(USART_TX_BUFFER_SIZE - (uint8_t)(head - tx_tail))) {
+        return usart_error_overrun;
+    }
+
+    for (segment = segments; segment < segments + count; segment++) {
+        // Copy until the end of the buffer, then the rest from the start.
+        len = segment->len;
+        index = head & (USART_TX_BUFFER_SIZE - 1);
+        span = USART_TX_BUFFER_SIZE - index;
+        if (span > len) {
+            span = len;
+        }
+
+        if (segment->is_progmem) {
+            memcpy_P(&tx_buffer[index], segment->data, span);
+            memcpy_P(tx_buffer, segment->data + span, len - span);
+        } else {
+            memcpy(&tx_buffer[index], segment->data, span);
+            memcpy(tx_buffer, segment->data + span, len - span);
+        }
+
+        head += len;
+    }
+    tx_head = head;
+
+    if (total > 0) {
+        start_transmit();
+    }
+
+    return usart_success;
+}
+
+/**
+ * @brief Queue an address frame, with the 9th bit set, to select a node in
+ * multi-processor communication mode, without blocking. Bytes queued after it
+ * are transmitted as data frames, with the 9th bit cleared. It's queued like
+ * data, so it keeps its order and takes the RS-485 bus. USART should be
+ * initialized with 9 data bits.
+ *
+ * @param address Address of the node.
+ *
+ * @returns `usart_error_overrun` if the buffer is full, `usart_success`
+ * otherwise.
+ * */
+enum usart_result usart_transmit_irq_address(uint8_t address) {
+    uint8_t head, index, sreg;
+
+    head = tx_head;
+    if ((uint8_t)(head - tx_tail) == USART_TX_BUFFER_SIZE) {
+        return usart_error_overrun;
+    }
+
+    index = head & (USART_TX_BUFFER_SIZE - 1);
+    tx_buffer[index] = address;
+
+    // Interrupt clears the marks of the other slots in the same byte.
+    ENTER_CRITICAL(sreg);
+    tx_address_marks[index >> 3] |= BIT(index & 7);
+    tx_address_count++;
+    EXIT_CRITICAL(sreg);
+
+    tx_head = head + 1;
+    start_transmit();
+
+    return usart_success;
+}
+
+/**
+ * @brief Get free space of the transmit buffer.
+ *
+ * @returns Number of bytes that can be queued without being dropped.
+ * */
+uint8_t usart_transmit_irq_free() {
+    return USART_TX_BUFFER_SIZE - (uint8_t)(tx_head - tx_tail);
+}
+
+/**
+ * @brief Block until all of the queued bytes are transmitted, including the
+ * last one in the transmit shift register. Useful before sleeping or turning
+ * the transmitter off.
+ * */
+void usart_transmit_irq_flush() {
+    // Wait until the buffer is moved to the transmitter.
+    loop_until_bit_is_clear(UCSR0B, UDRIE0);
+
+    // In RS-485 mode, transmit complete interrupt clears the flag itself.
+    if (rs485_port) {
+        while (tx_started) {
+        }
+        return;
+    }
+
+    // Then wait until the last byte is shifted out.
+    if (tx_started) {
+        loop_until_bit_is_set(UCSR0A, TXC0);
+        tx_started = 0;
+    }
+}
+
+/*******************************************************************************
+ * RS-485.
+ ******************************************************************************/
+
+/**
+ * @brief Enable RS-485 mode. Driver enable pin is driven high while the
+ * interrupt driven functions transmit, and driven low by the transmit complete
+ * interrupt after the last stop bit. So that the bus is released within a few
+ * cycles, without waiting for it. Pin is configured as an output, and driven
+ * low.
+ *
+ * @param driver_enable Driver enable (DE) pin of the transceiver.
+ *
+ * @returns `usart_error` if the pin is invalid, `usart_success` otherwise.
+ * */
+enum usart_result usart_rs485_enable(struct hal_io_pin driver_enable) {
+    uint8_t sreg;
+
+    CHECK_ARGUMENT(driver_enable.port > hal_io_port_d, usart_error);
+    CHECK_ARGUMENT(driver_enable.pin > 7, usart_error);
+
+    // Wait for any ongoing transmission, before the pin takes over the bus.
+    usart_transmit_irq_flush();
+
+    ENTER_CRITICAL(sreg);
+    rs485_mask = BIT(driver_enable.pin);
+    rs485_port = &HAL_IO_PORT_REGISTER(driver_enable.port);
+    *rs485_port &= (uint8_t)~rs485_mask;
+    HAL_IO_DDR_REGISTER(driver_enable.port) |= rs485_mask;
+
+    // Any earlier transmit complete flag would release the bus too early.
+    UCSR0A = (UCSR0A & (BIT(U2X0) | BIT(MPCM0))) | BIT(TXC0);
+    SET_BIT(UCSR0B, TXCIE0);
+    EXIT_CRITICAL(sreg);
+
+    return usart_success;
+}
+
+/**
+ * @brief Disable RS-485 mode. Waits until the bus is released. Driver enable
+ * pin is left as a low output.
+ * */
+void usart_rs485_disable() {
+    uint8_t sreg;
+
+    usart_transmit_irq_flush();
+
+    ENTER_CRITICAL(sreg);
+    CLEAR_BIT(UCSR0B, TXCIE0);
+    rs485_port = NULL;
+    EXIT_CRITICAL(sreg);
+}
@@ -0,0 +1,142 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief USART receive with a timeout for ATmega328P HAL driver, for both
+ * blocking functions and stdio. Time is measured by the timer0 system tick, so
+ * this is apart from hal_usart.c and hal_usart_extra.c, and timer0 interrupts
+ * are linked only if it's used.
+ * */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_internals.h"
+#include "hal_timer0.h"
+#include "hal_usart.h"
+
+#include <avr/io.h>
+#include <stdio.h>
+
+#ifndef F_CPU
+#warning "CPU frequency (F_CPU) is not defined! Defaulting to 16 MHz."
+#define F_CPU 16000000UL
+#endif // F_CPU
+
+/**
+ * Convert milliseconds to counts of the timer0 system tick, 64 CPU cycles each.
+ */
+#define TIMEOUT_COUNTS(ms) ((uint32_t)(ms) * (F_CPU / 1000) / 64)
+
+/**
+ * @brief Receive data over USART, with a timeout. Time is measured by the
+ * timer0 system tick, which should be running, see hal_timer0_tick_init(). It
+ * counts 256 per overflow, so timer0 shouldn't be in a mode with OCR0A as TOP.
+ * @param data Data buffer that will hold read data from USART buffer.
+ * @param len Data buffer length.
+ * @param received Number of received bytes, even if an error occurs.
+ * @param timeout_ms Total timeout, in milliseconds. 0 to disable.
+ * @param byte_timeout_ms Timeout between 2 bytes, in milliseconds. 0 to
+ * disable.
+ *
+ * @returns `usart_error_timeout` if any of the timeouts is reached. Receive
+ * errors like usart_receive().
+ * */
+enum usart_result usart_receive_timeout(uint8_t *data, uint16_t len,
+                                        uint16_t *received,
+                                        uint16_t timeout_ms,
+                                        uint16_t byte_timeout_ms) {
+    enum usart_result result;
+    uint32_t timeout, byte_timeout, start, last, now;
+    uint16_t i;
+    uint8_t status;
+
+    result = usart_success;
+    timeout = TIMEOUT_COUNTS(timeout_ms);
+    byte_timeout = TIMEOUT_COUNTS(byte_timeout_ms);
+    start = hal_timer0_tick_get_counts();
+    last = start;
+
+    for (i = 0; i < len;) {
+        if (bit_is_set(UCSR0A, RXC0)) {
+            // Error flags are valid until the data register is read.
+            status = UCSR0A;
+            data[i++] = UDR0;
+
+            if (status & BIT(FE0)) {
+                result = usart_error_framing;
+                break;
+            }
+            if (status & BIT(UPE0)) {
+                result = usart_error_parity;
+                break;
+            }
+            if (status & BIT(DOR0)) {
+                result = usart_error_overrun;
+                break;
+            }
+
+            last = hal_timer0_tick_get_counts();
+            continue;
+        }
+
+        // Differences are still right after the counts wrap around.
+        now = hal_timer0_tick_get_counts();
+        if ((timeout != 0 && now - start >= timeout) ||
+            (byte_timeout != 0 && now - last >= byte_timeout)) {
+            result = usart_error_timeout;
+            break;
+        }
+    }
+
+    *received = i;
+
+    return result;
+}
+
+/*******************************************************************************
+ * Standard I/O support.
+ ******************************************************************************/
+
+/**
+ * Receive timeout of stdin, in milliseconds. 0 if disabled.
+ * */
+static uint16_t stdio_timeout;
+
+/**
+ * @brief Receive a char on USART for stdio, with a timeout.
+ * @param stream I/O stream (only here cause it's necessary).
+ * @returns Received char, or end of file after a timeout.
+ * */
+static int usart_stdio_receive_char_timeout(FILE *stream) {
+    uint16_t received;
+    uint8_t c;
+
+    (void)stream;
+
+    // Timeout ends the stream.
+    usart_receive_timeout(&c, 1, &received, stdio_timeout, 0);
+    if (received == 0) {
+        return _FDEV_EOF;
+    }
+
+    return c;
+}
+
+/**
+ * Standard input stream, with a timeout.
+ * */
+static FILE hal_stdin_timeout = FDEV_SETUP_STREAM(
+    NULL, usart_stdio_receive_char_timeout, _FDEV_SETUP_READ);
+
+/**
+ * @brief Set receive timeout of stdin. After a timeout, stdin reports end of
+ * file, so that functions like `fgets()` return. Timeout is measured by the
+ * timer0 system tick, like usart_receive_timeout(). Should be called after
+ * usart_stdio_init() or usart_stdio_init_buffered(), which set a stdin without
+ * a timeout.
+ * @param timeout_ms Timeout for each char, in milliseconds. 0 to disable.
+ * */
+void usart_stdio_set_timeout(uint16_t timeout_ms) {
+    stdio_timeout = timeout_ms;
+    stdin = &hal_stdin_timeout;
+}
@@ -11,7 +11,17 @@
 #ifndef __INTERRUPT_H
 #define __INTERRUPT_H
 
-#define sei()
-#define cli()
+#include <stdint.h>
+
+extern uint8_t __atmega328p_registers[];
+
+/// Global interrupt flag of SREG, which is checked by the USART model before
+/// taking an interrupt.
+#define sei() (__atmega328p_registers[0x5F] |= 0x80)
+#define cli() (__atmega328p_registers[0x5F] &= ~0x80)
+
+/// Interrupt service routines are plain functions, so that tests can call them
+/// to simulate an interrupt.
+#define ISR(vector, ...) void vector(void)
 
 #endif // __INTERRUPT_H
@@ -0,0 +1,24 @@
+/**
+ * @file pgmspace.h
+ * @author Ceyhun Şen
+ * @brief Mock-up header of program memory utilities. Program memory is the same
+ * as the data memory on host machine. This header must overwrite avr/pgmspace.h
+ * for testing.
+ */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef __PGMSPACE_H
+#define __PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_dword(address) (*(const uint32_t *)(address))
+#define memcpy_P(destination, source, size) memcpy(destination, source, size)
+
+#endif // __PGMSPACE_H
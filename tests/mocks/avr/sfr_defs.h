@@ -15,6 +15,13 @@
 
 extern uint8_t __atmega328p_registers[];
 
+// Hooks of the USART model, see test_mock_up.c.
+uint8_t *mock_usart_register(uint8_t address);
+uint16_t *mock_usart_data();
+uint8_t *mock_pin_register(uint8_t address);
+uint16_t *mock_timer1_counter();
+void mock_wait();
+
 #define _MMIO_BYTE(mem_addr) __atmega328p_registers[mem_addr]
 #define _MMIO_WORD(mem_addr) __atmega328p_registers[mem_addr]
 #define _MMIO_DWORD(mem_addr) __atmega328p_registers[mem_addr]
@@ -23,21 +30,41 @@ extern uint8_t __atmega328p_registers[];
 
 #define _BV(bit) (1 << (bit))
 
-#define _SFR_MEM8(mem_addr) _MMIO_BYTE(mem_addr)
-#define _SFR_MEM16(mem_addr) _MMIO_WORD(mem_addr)
+#define _VECTOR(N) __vector_##N
+
+/// USART status (0xC0) and data (0xC6) registers are accessed through the
+/// USART model. Data register is 16 bits wide here, so that the model can mark
+/// the value that is read in the high byte, which a write of a byte clears.
+#define _SFR_MEM8(mem_addr)                                                    \
+    __builtin_choose_expr(                                                     \
+        (mem_addr) == 0xC6, *mock_usart_data(),                                \
+        (*((mem_addr) == 0xC0 ? mock_usart_register(mem_addr)                  \
+                              : &_MMIO_BYTE(mem_addr))))
+/// Timer1 counter (0x84) is counted by the USART model. Other 16-bit
+/// registers span their low and high bytes.
+#define _SFR_MEM16(mem_addr)                                                   \
+    (*((mem_addr) == 0x84 ? mock_timer1_counter()                              \
+                          : (uint16_t *)&_MMIO_WORD(mem_addr)))
 #define _SFR_MEM32(mem_addr) _MMIO_DWORD(mem_addr)
 
-#define _SFR_IO8(io_addr) _MMIO_BYTE((io_addr) + __SFR_OFFSET)
+/// Port D input register (0x09) is read through the USART model, which drives
+/// the RXD0 pin.
+#define _SFR_IO8(io_addr)                                                      \
+    (*((io_addr) == 0x09 ? mock_pin_register((io_addr) + __SFR_OFFSET)         \
+                         : &_MMIO_BYTE((io_addr) + __SFR_OFFSET)))
 #define _SFR_IO16(io_addr) _MMIO_WORD((io_addr) + __SFR_OFFSET)
 
 #define bit_is_set(sfr, bit) (sfr & _BV(bit))
 #define bit_is_clear(sfr, bit) (!(sfr & _BV(bit)))
 
+/// Busy-wait loops advance virtual time, see mock_wait().
 #define loop_until_bit_is_set(sfr, bit)                                        \
-    do {                                                                       \
-    } while (bit_is_clear(sfr, bit))
+    while (bit_is_clear(sfr, bit)) {                                           \
+        mock_wait();                                                           \
+    }
 #define loop_until_bit_is_clear(sfr, bit)                                      \
-    do {                                                                       \
-    } while (bit_is_set(sfr, bit))
+    while (bit_is_set(sfr, bit)) {                                             \
+        mock_wait();                                                           \
+    }
 
 #endif // __SFR_DEFS_H
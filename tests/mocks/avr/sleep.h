@@ -11,9 +11,13 @@
 #ifndef __SLEEP_H
 #define __SLEEP_H
 
+#include <avr/io.h>
+
 /// Callback function to check for things if there are things needed to be done
 /// after the sleep instruction. Needs to be defined per test file.
 void sleep_callback();
 #define sleep_cpu() sleep_callback()
+#define sleep_enable() (SMCR |= _BV(SE))
+#define sleep_disable() (SMCR &= ~_BV(SE))
 
 #endif // __SLEEP_H
@@ -8,9 +8,9 @@
 // SPDX-FileCopyrightText: 2023 Ceyhun Şen <ceyhuusen@gmail.com>
 // SPDX-License-Identifier: MIT
 
-#ifndef __SLEEP_H
-#define __SLEEP_H
+#ifndef __WDT_H
+#define __WDT_H
 
 #define wdt_reset()
 
-#endif // __SLEEP_H
+#endif // __WDT_H
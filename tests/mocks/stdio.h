@@ -0,0 +1,51 @@
+/**
+ * @file stdio.h
+ * @author Ceyhun Şen
+ * @brief Mock-up header of avr-libc streams. Host's standard I/O is still
+ * there, but `FILE`, `stdin` and `stdout` are avr-libc like streams, which call
+ * a put or a get function for each char. This header must overwrite stdio.h
+ * for testing.
+ */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#ifndef __MOCK_STDIO_H
+#define __MOCK_STDIO_H
+
+#include_next <stdio.h>
+
+#include <stdint.h>
+
+/**
+ * A stream of avr-libc, see FDEV_SETUP_STREAM().
+ */
+struct mock_stream {
+    int (*put)(char, struct mock_stream *);
+    int (*get)(struct mock_stream *);
+    uint8_t flags;
+};
+
+#define FILE struct mock_stream
+
+#undef stdin
+#undef stdout
+#define stdin mock_stdin
+#define stdout mock_stdout
+extern FILE *mock_stdin;
+extern FILE *mock_stdout;
+
+#define _FDEV_SETUP_READ 0x01
+#define _FDEV_SETUP_WRITE 0x02
+#define _FDEV_SETUP_RW (_FDEV_SETUP_READ | _FDEV_SETUP_WRITE)
+
+#define _FDEV_ERR (-1)
+#define _FDEV_EOF (-2)
+
+#define FDEV_SETUP_STREAM(p, g, f) {.put = p, .get = g, .flags = f}
+
+// Char I/O of avr-libc on stdin and stdout, see test_mock_up.c.
+int mock_stdio_putc(char c);
+int mock_stdio_getc();
+
+#endif // __MOCK_STDIO_H
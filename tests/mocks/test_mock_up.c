@@ -9,8 +9,10 @@
 
 #include "test_mock_up.h"
 
+#include <avr/io.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 /**
@@ -18,12 +20,17 @@
  */
 uint8_t __atmega328p_registers[0xFF];
 
+static void reset_usart();
+
 /**
  * @brief Reset virtual memory.
  */
 void reset_registers() {
     // Reset everything to zero.
     memset(__atmega328p_registers, 0, sizeof __atmega328p_registers);
+
+    // USART model is disabled too.
+    reset_usart();
 }
 
 /**
@@ -35,3 +42,697 @@ void spawn_watcher_thread(void *(*handler)()) {
     pthread_t t;
     pthread_create(&t, NULL, handler, NULL);
 }
+
+/*******************************************************************************
+ * USART model.
+ ******************************************************************************/
+
+/**
+ * Raw access to a register, without the USART hook.
+ */
+#define RAW_REGISTER(address) __atmega328p_registers[address]
+
+/**
+ * Raw access to the data register, with the reserved register after it as its
+ * high byte.
+ */
+#define RAW_DATA_REGISTER (*(uint16_t *)&RAW_REGISTER(ADDRESS_UDR0))
+
+/**
+ * Mark on the high byte of the data register, while it holds a value to be
+ * read. Writing a byte clears it.
+ */
+#define DATA_READ_MARK 0x0100
+
+#define ADDRESS_PIND 0x29
+#define ADDRESS_SREG 0x5F
+#define ADDRESS_TCCR1B 0x81
+#define ADDRESS_UCSR0A 0xC0
+#define ADDRESS_UCSR0B 0xC1
+#define ADDRESS_UCSR0C 0xC2
+#define ADDRESS_UBRR0L 0xC4
+#define ADDRESS_UBRR0H 0xC5
+#define ADDRESS_UDR0 0xC6
+
+/**
+ * Depth of the hardware receive buffer.
+ */
+#define RX_FIFO_SIZE 2
+
+/**
+ * Maximum number of interrupts taken in a row, before time is advanced. Stops
+ * an interrupt that doesn't clear its flag from hanging the test.
+ */
+#define MAX_NESTED_INTERRUPTS 16
+
+/**
+ * Pin number of the RXD0 receive pin, in port D.
+ */
+#define RXD0_PIN 0
+
+/**
+ * CPU cycles of a pin read in a polling loop, an `sbic` and a jump back.
+ */
+#define PIN_POLL_CYCLES 4
+
+/**
+ * CPU cycles of a USART register access, an `lds` or an `sts`. The code
+ * between the accesses takes no time.
+ */
+#define REGISTER_ACCESS_CYCLES 2
+
+// Interrupt service routines of the USART driver, if it is linked.
+void __vector_18(void) __attribute__((weak));
+void __vector_19(void) __attribute__((weak));
+void __vector_20(void) __attribute__((weak));
+
+/**
+ * State of the USART model.
+ */
+static struct {
+    uint8_t is_enabled;
+
+    /// Virtual time, in CPU cycles.
+    uint32_t time;
+
+    /// Register that is accessed last, and the value that was put in it. The
+    /// access is found out to be a read or a write on the next access.
+    uint8_t pending_address;
+    uint8_t pending_value;
+
+    /// U2X0 and MPCM0 bits, which are written by the driver.
+    uint8_t control;
+    uint8_t is_transmit_complete;
+    uint8_t is_overrun;
+
+    /// Transmit buffer and shift register.
+    uint8_t tx_data;
+    uint8_t is_tx_data_full;
+    uint8_t is_shifting;
+    uint8_t shift_data;
+    uint8_t shift_ninth_bit;
+    uint32_t shift_start;
+    uint32_t shift_end;
+
+    /// Receive buffer, and the last byte read from it.
+    uint8_t rx_fifo[RX_FIFO_SIZE];
+    uint8_t rx_fifo_index[RX_FIFO_SIZE];
+    uint8_t rx_count;
+    uint8_t rx_last;
+
+    /// Bytes on the wires. Received bytes are queued here when injected.
+    struct mock_usart_byte transmitted[MOCK_USART_LOG_SIZE];
+    uint16_t transmitted_count;
+    struct mock_usart_byte received[MOCK_USART_LOG_SIZE];
+    uint16_t received_count;
+    uint16_t received_arrived;
+
+    /// When the receive wire is free for the next injected byte.
+    uint32_t rx_free;
+
+    /// Timer1 counter, the value that was put in it, and when it is counted
+    /// last.
+    uint16_t timer1_count;
+    uint16_t timer1_pending;
+    uint32_t timer1_time;
+} usart;
+
+/**
+ * @brief Disable the USART model and clear its state.
+ */
+static void reset_usart() { memset(&usart, 0, sizeof usart); }
+
+/**
+ * @brief Check if the USART is in master SPI mode.
+ */
+static uint8_t is_spi_master() {
+    return (RAW_REGISTER(ADDRESS_UCSR0C) & (_BV(UMSEL01) | _BV(UMSEL00))) ==
+           (_BV(UMSEL01) | _BV(UMSEL00));
+}
+
+/**
+ * @brief Get the length of a bit on the wire, in CPU cycles, from the current
+ * settings.
+ */
+static uint32_t bit_cycles() {
+    uint32_t cycles;
+
+    cycles = ((uint32_t)(RAW_REGISTER(ADDRESS_UBRR0H) & 0x0F) << 8 |
+              RAW_REGISTER(ADDRESS_UBRR0L)) +
+             1;
+
+    if (is_spi_master()) {
+        return cycles * 2;
+    }
+
+    return cycles * (usart.control & _BV(U2X0) ? 8 : 16);
+}
+
+/**
+ * @brief Get the length of a frame on the wire, in CPU cycles, from the
+ * current settings.
+ */
+static uint32_t frame_cycles() {
+    uint32_t bits;
+    uint8_t size;
+
+    if (is_spi_master()) {
+        return 8 * bit_cycles();
+    }
+
+    size = (RAW_REGISTER(ADDRESS_UCSR0C) >> UCSZ00) & 0x03;
+    if (RAW_REGISTER(ADDRESS_UCSR0B) & _BV(UCSZ02)) {
+        size |= 0x04;
+    }
+
+    // Start bit, data bits, parity bit and stop bits.
+    bits = 1 + (size == 7 ? 9 : 5 + (size & 0x03));
+    if (RAW_REGISTER(ADDRESS_UCSR0C) & _BV(UPM01)) {
+        bits++;
+    }
+    bits += RAW_REGISTER(ADDRESS_UCSR0C) & _BV(USBS0) ? 2 : 1;
+
+    return bits * bit_cycles();
+}
+
+/**
+ * @brief Get the status register value of the model.
+ */
+static uint8_t status() {
+    uint8_t value = usart.control;
+
+    if (usart.rx_count > 0) {
+        value |= _BV(RXC0);
+    }
+    if (usart.is_transmit_complete) {
+        value |= _BV(TXC0);
+    }
+    if (!usart.is_tx_data_full) {
+        value |= _BV(UDRE0);
+    }
+    if (usart.is_overrun) {
+        value |= _BV(DOR0);
+    }
+
+    return value;
+}
+
+/**
+ * @brief Move the transmit buffer to the shift register.
+ */
+static void start_shifting() {
+    usart.shift_data = usart.tx_data;
+    usart.shift_ninth_bit = (RAW_REGISTER(ADDRESS_UCSR0B) & _BV(TXB80)) != 0;
+    usart.is_tx_data_full = 0;
+    usart.is_shifting = 1;
+    usart.shift_start = usart.time;
+    usart.shift_end = usart.time + frame_cycles();
+}
+
+/**
+ * @brief Find out if the last access to a hooked register was a read or a
+ * write, and apply it.
+ *
+ * Data register holds the value to be read with `DATA_READ_MARK`, so an
+ * access that cleared the mark is a write. Status register is written only if
+ * the value changed, which is enough for its control bits.
+ */
+static void resolve_access() {
+    uint8_t value;
+
+    if (usart.pending_address == 0) {
+        return;
+    }
+
+    if (usart.pending_address == ADDRESS_UCSR0A) {
+        value = RAW_REGISTER(ADDRESS_UCSR0A);
+        if (value != usart.pending_value) {
+            usart.control = value & (_BV(U2X0) | _BV(MPCM0));
+
+            // Transmit complete flag is cleared by writing 1.
+            if (value & _BV(TXC0)) {
+                usart.is_transmit_complete = 0;
+            }
+        }
+        usart.pending_address = 0;
+        return;
+    }
+
+    value = (uint8_t)RAW_DATA_REGISTER;
+    if (!(RAW_DATA_REGISTER & DATA_READ_MARK)) {
+        // Writes are ignored while the transmit buffer is full.
+        if ((RAW_REGISTER(ADDRESS_UCSR0B) & _BV(TXEN0)) &&
+            !usart.is_tx_data_full) {
+            usart.tx_data = value;
+            usart.is_tx_data_full = 1;
+            if (!usart.is_shifting) {
+                start_shifting();
+            }
+        }
+    } else if (usart.rx_count > 0) {
+        usart.rx_last = usart.rx_fifo[0];
+        usart.received[usart.rx_fifo_index[0]].read = usart.time;
+        usart.rx_fifo[0] = usart.rx_fifo[1];
+        usart.rx_fifo_index[0] = usart.rx_fifo_index[1];
+        usart.rx_count--;
+        usart.is_overrun = 0;
+    }
+
+    // Plain value is left for the tests.
+    RAW_DATA_REGISTER = value;
+    usart.pending_address = 0;
+}
+
+/**
+ * @brief Start an access to a hooked register. Resolves the last access, and
+ * advances time by the cost of this one. Interrupts may be taken meanwhile.
+ * @param address Register address.
+ */
+static void start_access(uint8_t address) {
+    resolve_access();
+    mock_advance(REGISTER_ACCESS_CYCLES);
+    resolve_access();
+
+    usart.pending_address = address;
+}
+
+/**
+ * @brief Hook of the USART status register. Resolves the last access, then
+ * puts the current value of the register in it.
+ * @param address Register address.
+ * @returns Pointer to the register.
+ */
+uint8_t *mock_usart_register(uint8_t address) {
+    if (!usart.is_enabled) {
+        return &RAW_REGISTER(address);
+    }
+
+    start_access(address);
+    usart.pending_value = status();
+    RAW_REGISTER(address) = usart.pending_value;
+
+    return &RAW_REGISTER(address);
+}
+
+/**
+ * @brief Hook of the USART data register. Resolves the last access, then puts
+ * the byte to be read in it, marked with `DATA_READ_MARK`.
+ * @returns Pointer to the register.
+ */
+uint16_t *mock_usart_data() {
+    if (!usart.is_enabled) {
+        return &RAW_DATA_REGISTER;
+    }
+
+    start_access(ADDRESS_UDR0);
+    RAW_DATA_REGISTER =
+        DATA_READ_MARK | (usart.rx_count > 0 ? usart.rx_fifo[0] : usart.rx_last);
+
+    return &RAW_DATA_REGISTER;
+}
+
+/**
+ * @brief Get the level of the receive wire, at the current time. Bytes are
+ * taken as a start bit and 8 data bits, followed by stop bits.
+ * @returns 1 for high, 0 for low.
+ */
+static uint8_t rx_level() {
+    struct mock_usart_byte *byte;
+    uint32_t bit;
+
+    if (usart.received_arrived == usart.received_count) {
+        return 1;
+    }
+    byte = &usart.received[usart.received_arrived];
+    if ((int32_t)(usart.time - byte->start) < 0) {
+        return 1;
+    }
+
+    bit = (usart.time - byte->start) / byte->bit_cycles;
+    if (bit == 0) {
+        return 0;
+    }
+    if (bit <= 8) {
+        return (byte->data >> (bit - 1)) & 1;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Hook of the port D input register. RXD0 pin follows the receive
+ * wire, and each read advances time, like a polling loop.
+ * @param address Register address.
+ * @returns Pointer to the register.
+ */
+uint8_t *mock_pin_register(uint8_t address) {
+    if (!usart.is_enabled) {
+        return &RAW_REGISTER(address);
+    }
+
+    mock_advance(PIN_POLL_CYCLES);
+
+    if (rx_level()) {
+        RAW_REGISTER(address) |= _BV(RXD0_PIN);
+    } else {
+        RAW_REGISTER(address) &= ~_BV(RXD0_PIN);
+    }
+
+    return &RAW_REGISTER(address);
+}
+
+/**
+ * @brief Hook of the timer1 counter. It counts CPU cycles while timer1 runs
+ * without a prescaler, other clock sources are taken as stopped. A value that
+ * differs from the one put in it on the last access is a write.
+ * @returns Pointer to the counter.
+ */
+uint16_t *mock_timer1_counter() {
+    if (!usart.is_enabled) {
+        return &usart.timer1_count;
+    }
+
+    if (usart.timer1_count == usart.timer1_pending &&
+        (RAW_REGISTER(ADDRESS_TCCR1B) & (_BV(CS12) | _BV(CS11) | _BV(CS10))) ==
+            _BV(CS10)) {
+        usart.timer1_count += usart.time - usart.timer1_time;
+    }
+    usart.timer1_time = usart.time;
+    usart.timer1_pending = usart.timer1_count;
+
+    return &usart.timer1_count;
+}
+
+/**
+ * @brief Take an interrupt, if it is enabled.
+ * @returns 1 if it is taken, 0 otherwise.
+ */
+static uint8_t take_interrupt(uint8_t enable_bit, uint8_t is_requested,
+                              void (*vector)(void)) {
+    if (!is_requested || !(RAW_REGISTER(ADDRESS_UCSR0B) & _BV(enable_bit)) ||
+        vector == NULL) {
+        return 0;
+    }
+
+    // Global interrupt flag is cleared while an interrupt runs.
+    RAW_REGISTER(ADDRESS_SREG) &= ~_BV(SREG_I);
+    vector();
+    resolve_access();
+    RAW_REGISTER(ADDRESS_SREG) |= _BV(SREG_I);
+
+    return 1;
+}
+
+/**
+ * @brief Take pending interrupts, in the order of their priority.
+ */
+static void take_interrupts() {
+    uint8_t count;
+
+    resolve_access();
+
+    for (count = 0; count < MAX_NESTED_INTERRUPTS; count++) {
+        if (!(RAW_REGISTER(ADDRESS_SREG) & _BV(SREG_I))) {
+            return;
+        }
+
+        if (take_interrupt(RXCIE0, usart.rx_count > 0, __vector_18)) {
+            continue;
+        }
+        if (take_interrupt(UDRIE0, !usart.is_tx_data_full, __vector_19)) {
+            continue;
+        }
+
+        // Transmit complete flag is cleared by the hardware, when its
+        // interrupt is taken.
+        if (usart.is_transmit_complete &&
+            (RAW_REGISTER(ADDRESS_UCSR0B) & _BV(TXCIE0)) &&
+            __vector_20 != NULL) {
+            usart.is_transmit_complete = 0;
+            take_interrupt(TXCIE0, 1, __vector_20);
+            continue;
+        }
+
+        return;
+    }
+}
+
+/**
+ * @brief Get the time of the next event of the model.
+ * @param time Time of the event.
+ * @returns 1 if there is an event, 0 otherwise.
+ */
+static uint8_t next_event(uint32_t *time) {
+    uint8_t has_event = 0;
+    struct mock_usart_byte *byte;
+
+    if (usart.is_shifting) {
+        *time = usart.shift_end;
+        has_event = 1;
+    }
+
+    if (usart.received_arrived < usart.received_count) {
+        byte = &usart.received[usart.received_arrived];
+        if (!has_event || (int32_t)(byte->end - *time) < 0) {
+            *time = byte->end;
+        }
+        has_event = 1;
+    }
+
+    return has_event;
+}
+
+/**
+ * @brief Run the events that are due.
+ */
+static void run_events() {
+    struct mock_usart_byte *byte;
+
+    if (usart.is_shifting && (int32_t)(usart.time - usart.shift_end) >= 0) {
+        if (usart.transmitted_count < MOCK_USART_LOG_SIZE) {
+            byte = &usart.transmitted[usart.transmitted_count++];
+            byte->data = usart.shift_data;
+            byte->ninth_bit = usart.shift_ninth_bit;
+            byte->start = usart.shift_start;
+            byte->end = usart.shift_end;
+        }
+
+        // In master SPI mode, transmit line is looped back to the receiver.
+        if (is_spi_master() && usart.received_count < MOCK_USART_LOG_SIZE) {
+            byte = &usart.received[usart.received_count++];
+            byte->data = usart.shift_data;
+            byte->start = usart.shift_start;
+            byte->end = usart.shift_end;
+            byte->bit_cycles = bit_cycles();
+        }
+
+        usart.is_shifting = 0;
+        if (usart.is_tx_data_full) {
+            start_shifting();
+        } else {
+            usart.is_transmit_complete = 1;
+        }
+    }
+
+    while (usart.received_arrived < usart.received_count &&
+           (int32_t)(usart.time - usart.received[usart.received_arrived].end) >=
+               0) {
+        byte = &usart.received[usart.received_arrived];
+
+        if (!(RAW_REGISTER(ADDRESS_UCSR0B) & _BV(RXEN0))) {
+            // Receiver is disabled, byte is lost.
+        } else if (usart.rx_count == RX_FIFO_SIZE) {
+            byte->is_overrun = 1;
+            usart.is_overrun = 1;
+        } else {
+            usart.rx_fifo[usart.rx_count] = byte->data;
+            usart.rx_fifo_index[usart.rx_count] = usart.received_arrived;
+            usart.rx_count++;
+        }
+
+        usart.received_arrived++;
+    }
+}
+
+/**
+ * @brief Advance virtual time. Events and interrupts are run on the way.
+ * @param cycles CPU cycles to advance.
+ */
+void mock_advance(uint32_t cycles) {
+    uint32_t end, time;
+
+    if (!usart.is_enabled) {
+        return;
+    }
+
+    end = usart.time + cycles;
+    take_interrupts();
+    while (next_event(&time) && (int32_t)(time - end) <= 0) {
+        // Interrupts may have advanced time already.
+        if ((int32_t)(time - usart.time) > 0) {
+            usart.time = time;
+        }
+        run_events();
+        take_interrupts();
+    }
+    if ((int32_t)(end - usart.time) > 0) {
+        usart.time = end;
+    }
+}
+
+/**
+ * @brief Called by each iteration of the busy-wait loops. Advances virtual
+ * time to the next event, or by a cycle if there is none.
+ */
+void mock_wait() {
+    uint32_t time;
+
+    if (!usart.is_enabled) {
+        return;
+    }
+
+    take_interrupts();
+    if (next_event(&time) && (int32_t)(time - usart.time) > 0) {
+        mock_advance(time - usart.time);
+    } else {
+        mock_advance(1);
+    }
+}
+
+/**
+ * @brief Get virtual time.
+ * @returns Virtual time in CPU cycles, since the model is enabled.
+ */
+uint32_t mock_get_time() { return usart.time; }
+
+/**
+ * @brief Enable the USART model. Until then, USART registers are plain
+ * memory. Interrupts are enabled too, they are taken while time advances.
+ */
+void mock_usart_enable() {
+    uint16_t timer1_count = usart.timer1_count;
+
+    memset(&usart, 0, sizeof usart);
+    usart.timer1_count = timer1_count;
+    usart.timer1_pending = timer1_count;
+    usart.control = RAW_REGISTER(ADDRESS_UCSR0A) & (_BV(U2X0) | _BV(MPCM0));
+    usart.is_enabled = 1;
+
+    RAW_REGISTER(ADDRESS_SREG) |= _BV(SREG_I);
+}
+
+/**
+ * @brief Get when the receive wire is free for the next injected byte.
+ */
+static uint32_t rx_free() {
+    return (int32_t)(usart.rx_free - usart.time) > 0 ? usart.rx_free
+                                                      : usart.time;
+}
+
+/**
+ * @brief Queue bytes on the receive wire, back to back.
+ */
+static void inject(const uint8_t *data, uint16_t len, uint32_t bit_cycles,
+                   uint32_t frame_cycles) {
+    struct mock_usart_byte *byte;
+    uint16_t i;
+
+    usart.rx_free = rx_free();
+    for (i = 0; i < len && usart.received_count < MOCK_USART_LOG_SIZE; i++) {
+        byte = &usart.received[usart.received_count++];
+        byte->data = data[i];
+        byte->start = usart.rx_free;
+        byte->end = usart.rx_free + frame_cycles;
+        byte->bit_cycles = bit_cycles;
+        usart.rx_free = byte->end;
+    }
+}
+
+/**
+ * @brief Send bytes to the receiver, from the other side of the wire. They
+ * are sent back to back, after the previously injected ones.
+ * @param data Bytes to be sent.
+ * @param len Byte count.
+ */
+void mock_usart_inject(const uint8_t *data, uint16_t len) {
+    inject(data, len, bit_cycles(), frame_cycles());
+}
+
+/**
+ * @brief Send 8N1 bytes to the receiver with the given bit time, like a
+ * sender at another baud rate. They are sent like mock_usart_inject().
+ * @param data Bytes to be sent.
+ * @param len Byte count.
+ * @param bit_cycles Length of a bit, in CPU cycles.
+ */
+void mock_usart_inject_bit_time(const uint8_t *data, uint16_t len,
+                                uint32_t bit_cycles) {
+    inject(data, len, bit_cycles, 10 * bit_cycles);
+}
+
+/**
+ * @brief Keep the receive wire idle, before the next injected bytes.
+ * @param cycles Idle time, in CPU cycles.
+ */
+void mock_usart_inject_idle(uint32_t cycles) {
+    usart.rx_free = rx_free() + cycles;
+}
+
+/**
+ * @brief Get the bytes that are transmitted by the USART.
+ * @param bytes Set to the transmitted bytes.
+ * @returns Transmitted byte count.
+ */
+uint16_t mock_usart_get_transmitted(const struct mock_usart_byte **bytes) {
+    resolve_access();
+    *bytes = usart.transmitted;
+
+    return usart.transmitted_count;
+}
+
+/**
+ * @brief Get the bytes that are injected to the receiver, including the ones
+ * that haven't arrived yet.
+ * @param bytes Set to the injected bytes.
+ * @returns Injected byte count.
+ */
+uint16_t mock_usart_get_received(const struct mock_usart_byte **bytes) {
+    resolve_access();
+    *bytes = usart.received;
+
+    return usart.received_count;
+}
+
+/*******************************************************************************
+ * Streams.
+ ******************************************************************************/
+
+FILE *mock_stdin;
+FILE *mock_stdout;
+
+/**
+ * @brief Write a char to stdout, like fputc() of avr-libc.
+ * @param c Char to write.
+ * @returns Written char, or EOF if the stream failed to write it.
+ */
+int mock_stdio_putc(char c) {
+    if (mock_stdout->put(c, mock_stdout) != 0) {
+        return EOF;
+    }
+
+    return (uint8_t)c;
+}
+
+/**
+ * @brief Read a char from stdin, like fgetc() of avr-libc.
+ * @returns Read char, or EOF at the end of the stream or on an error.
+ */
+int mock_stdio_getc() {
+    int c = mock_stdin->get(mock_stdin);
+
+    if (c < 0) {
+        return EOF;
+    }
+
+    return (uint8_t)c;
+}
@@ -14,7 +14,56 @@
 
 extern uint8_t __atmega328p_registers[0xFF];
 
+/**
+ * Maximum number of bytes that are logged in each direction by the USART
+ * model.
+ */
+#define MOCK_USART_LOG_SIZE 512
+
+/**
+ * A byte on the USART wires, logged by the USART model. Times are in CPU
+ * cycles of virtual time.
+ */
+struct mock_usart_byte {
+    uint8_t data;
+    uint8_t ninth_bit;   ///< 9th data bit of a transmitted byte.
+    uint8_t is_overrun;  ///< Received byte is lost, receive buffer was full.
+    uint32_t start;      ///< Start of the start bit.
+    uint32_t end;        ///< End of the last stop bit.
+    uint32_t read;       ///< When the received byte is read, 0 if it isn't.
+    uint32_t bit_cycles; ///< Length of a bit.
+};
+
+/**
+ * Run-time argument checks are compiled out in release builds, see
+ * hal_checks.h. Calls with invalid arguments are undefined behaviour then, so
+ * the tests of error results are skipped.
+ */
+#if defined(HAL_RELEASE_BUILD)
+#define SKIP_IN_RELEASE_BUILD()                                                \
+    TEST_IGNORE_MESSAGE("Run-time argument checks are compiled out.")
+#else
+#define SKIP_IN_RELEASE_BUILD()
+#endif
+
 void reset_registers();
 void spawn_watcher_thread(void *(*handler)());
 
+// Virtual time.
+void mock_advance(uint32_t cycles);
+void mock_wait();
+uint32_t mock_get_time();
+
+// USART model.
+void mock_usart_enable();
+void mock_usart_inject(const uint8_t *data, uint16_t len);
+void mock_usart_inject_bit_time(const uint8_t *data, uint16_t len,
+                                uint32_t bit_cycles);
+void mock_usart_inject_idle(uint32_t cycles);
+uint16_t mock_usart_get_transmitted(const struct mock_usart_byte **bytes);
+uint16_t mock_usart_get_received(const struct mock_usart_byte **bytes);
+uint8_t *mock_usart_register(uint8_t address);
+uint8_t *mock_pin_register(uint8_t address);
+uint16_t *mock_timer1_counter();
+
 #endif // __TEST_MOCK_UP_H
@@ -181,6 +181,7 @@ void test_change_and_read_clock_prescaler() {
     TEST_ASSERT_EQUAL(CLKPR, 0b1000);
     TEST_ASSERT_EQUAL(hal_clock_get_clock_prescaler(), hal_clock_prescaler_256);
 
+#if !defined(HAL_RELEASE_BUILD)
     // Passing a value bigger should return error and register should stay the
     // same.
     TEST_ASSERT_EQUAL(
@@ -188,6 +189,7 @@ void test_change_and_read_clock_prescaler() {
         hal_result_clock_invalid_prescaler);
     TEST_ASSERT_EQUAL(CLKPR, 0b1000);
     TEST_ASSERT_EQUAL(hal_clock_get_clock_prescaler(), hal_clock_prescaler_256);
+#endif // HAL_RELEASE_BUILD
 }
 
 int main() {
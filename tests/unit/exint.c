@@ -0,0 +1,148 @@
+/**
+ * @file
+ * @author Ceyhun Şen
+ * @brief Unit tests for external interrupts module.
+ */
+
+// SPDX-FileCopyrightText: 2026 Ceyhun Şen <ceyhuusen@gmail.com>
+// SPDX-License-Identifier: MIT
+
+#include "hal_exint.h"
+#include "hal_internals.h"
+
+#include "test_mock_up.h"
+
+#include "unity.h"
+
+#include <avr/io.h>
+
+static uint8_t int1_calls;
+static uint8_t last_changed, last_pins;
+
+static inline void on_int1(void) { int1_calls++; }
+HAL_EXINT_INT1_ISR(on_int1)
+
+static inline void on_port_d_change(uint8_t changed, uint8_t pins) {
+    last_changed = changed;
+    last_pins = pins;
+}
+HAL_EXINT_PCINT2_ISR(on_port_d_change)
+
+void test_errors() {
+    enum hal_result_exint result;
+
+    SKIP_IN_RELEASE_BUILD();
+
+    result = hal_exint_configure(hal_exint_int1 + 1, hal_exint_sense_any_edge);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_interrupt, result);
+
+    result =
+        hal_exint_configure(hal_exint_int0, hal_exint_sense_rising_edge + 1);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_sense, result);
+
+    result = hal_exint_enable(hal_exint_int1 + 1);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_interrupt, result);
+
+    result = hal_exint_disable(hal_exint_int1 + 1);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_interrupt, result);
+
+    result = hal_exint_clear(hal_exint_int1 + 1);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_interrupt, result);
+
+    result = hal_exint_pin_change_enable(hal_io_port_d + 1, 0xFF);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_port, result);
+
+    result = hal_exint_pin_change_disable(hal_io_port_d + 1);
+    TEST_ASSERT_EQUAL(hal_result_exint_invalid_port, result);
+
+    TEST_ASSERT_EQUAL(0, EICRA);
+    TEST_ASSERT_EQUAL(0, EIMSK);
+    TEST_ASSERT_EQUAL(0, PCICR);
+}
+
+void test_configure() {
+    enum hal_exint_sense sense;
+
+    for (sense = hal_exint_sense_low_level;
+         sense <= hal_exint_sense_rising_edge; sense++) {
+        TEST_ASSERT_EQUAL(hal_result_exint_ok,
+                          hal_exint_configure(hal_exint_int0, sense));
+        TEST_ASSERT_EQUAL(sense, EICRA);
+    }
+
+    for (sense = hal_exint_sense_low_level;
+         sense <= hal_exint_sense_rising_edge; sense++) {
+        TEST_ASSERT_EQUAL(hal_result_exint_ok,
+                          hal_exint_configure(hal_exint_int1, sense));
+        TEST_ASSERT_EQUAL(sense << 2 | hal_exint_sense_rising_edge, EICRA);
+    }
+}
+
+void test_enable_disable() {
+    TEST_ASSERT_EQUAL(hal_result_exint_ok, hal_exint_enable(hal_exint_int1));
+    TEST_ASSERT_EQUAL(BIT(INT1), EIMSK);
+
+    TEST_ASSERT_EQUAL(hal_result_exint_ok, hal_exint_enable(hal_exint_int0));
+    TEST_ASSERT_EQUAL(BIT(INT0) | BIT(INT1), EIMSK);
+
+    TEST_ASSERT_EQUAL(hal_result_exint_ok, hal_exint_disable(hal_exint_int1));
+    TEST_ASSERT_EQUAL(BIT(INT0), EIMSK);
+
+    TEST_ASSERT_EQUAL(hal_result_exint_ok, hal_exint_clear(hal_exint_int1));
+    TEST_ASSERT_EQUAL(BIT(INTF1), EIFR);
+}
+
+void test_int_handler() {
+    int1_calls = 0;
+
+    INT1_vect();
+    INT1_vect();
+
+    TEST_ASSERT_EQUAL(2, int1_calls);
+}
+
+void test_pin_change() {
+    PIND = 0b00010001;
+
+    TEST_ASSERT_EQUAL(hal_result_exint_ok,
+                      hal_exint_pin_change_enable(hal_io_port_d, 0b00110000));
+    TEST_ASSERT_EQUAL(0b00110000, PCMSK2);
+    TEST_ASSERT_EQUAL(BIT(PCIE2), PCICR);
+    TEST_ASSERT_EQUAL(BIT(PCIF2), PCIFR);
+    TEST_ASSERT_EQUAL(0, PCMSK0);
+    TEST_ASSERT_EQUAL(0, PCMSK1);
+
+    // Only enabled pins should be reported.
+    PIND = 0b00100000;
+    PCINT2_vect();
+    TEST_ASSERT_EQUAL(0b00110000, last_changed);
+    TEST_ASSERT_EQUAL(0b00100000, last_pins);
+
+    PIND = 0b00100001;
+    PCINT2_vect();
+    TEST_ASSERT_EQUAL(0, last_changed);
+
+    PIND = 0b00000001;
+    PCINT2_vect();
+    TEST_ASSERT_EQUAL(0b00100000, last_changed);
+    TEST_ASSERT_EQUAL(0b00000001, last_pins);
+
+    TEST_ASSERT_EQUAL(hal_result_exint_ok,
+                      hal_exint_pin_change_disable(hal_io_port_d));
+    TEST_ASSERT_EQUAL(0, PCMSK2);
+    TEST_ASSERT_EQUAL(0, PCICR);
+}
+
+int main() {
+    RUN_TEST(test_errors);
+    RUN_TEST(test_configure);
+    RUN_TEST(test_enable_disable);
+    RUN_TEST(test_int_handler);
+    RUN_TEST(test_pin_change);
+
+    return UnityEnd();
+}
+
+void setUp() { reset_registers(); }
+
+void tearDown() { reset_registers(); }
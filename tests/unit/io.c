@@ -11,8 +11,10 @@
 #include "unity.h"
 
 #include <avr/io.h>
+#include <avr/pgmspace.h>
 #include <test_mock_up.h>
 
+#include <stddef.h>
 #include <stdint.h>
 
 void test_errors() {
@@ -30,6 +32,8 @@ void test_errors() {
     result = hal_io_configure(io_pin, configuration);
     TEST_ASSERT_EQUAL(hal_result_io_ok, result);
 
+    SKIP_IN_RELEASE_BUILD();
+
     io_pin.pin = 9;
     result = hal_io_configure(io_pin, configuration);
     TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin, result);
@@ -370,6 +374,378 @@ void test_write_multi() {
     }
 }
 
+void test_configure_many_errors() {
+    struct hal_io_pin_configuration_entry table[] = {
+        {{hal_io_port_b, 0}, {hal_io_direction_output, 0}},
+        {{hal_io_port_c, 8}, {hal_io_direction_output, 0}},
+    };
+
+    SKIP_IN_RELEASE_BUILD();
+
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin,
+                      hal_io_configure_many(table, 2));
+
+    // Valid entries before the invalid one shouldn't be applied.
+    TEST_ASSERT_EQUAL(0, DDRB);
+
+    table[1].io.pin = 0;
+    table[1].io.port = hal_io_port_d + 1;
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_configure_many(table, 2));
+
+    table[1].io.port = hal_io_port_d;
+    table[1].configuration.direction = hal_io_direction_input + 1;
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_direction,
+                      hal_io_configure_many(table, 2));
+    TEST_ASSERT_EQUAL(0, DDRB);
+}
+
+void test_configure_many() {
+    static const struct hal_io_pin_configuration_entry table[] PROGMEM = {
+        {{hal_io_port_b, 0}, {hal_io_direction_output, 0}},
+        {{hal_io_port_b, 1}, {hal_io_direction_input, 1}},
+        {{hal_io_port_b, 2}, {hal_io_direction_input, 0}},
+        {{hal_io_port_b, 3}, {hal_io_direction_output, 0}},
+        {{hal_io_port_d, 7}, {hal_io_direction_input, 1}},
+        {{hal_io_port_d, 6}, {hal_io_direction_output, 0}},
+        // Overrides the first entry.
+        {{hal_io_port_b, 0}, {hal_io_direction_input, 1}},
+    };
+    enum hal_result_io result;
+
+    // Pin 2 is output high, pin 3 is output high and pin 4 is unlisted.
+    DDRB = 0b00011100;
+    PORTB = 0b00011100;
+    DDRC = 0xFF;
+    PORTC = 0xAA;
+
+    result = hal_io_configure_many_P(table, sizeof table / sizeof table[0]);
+    TEST_ASSERT_EQUAL(hal_result_io_ok, result);
+
+    TEST_ASSERT_EQUAL(0b00011000, DDRB);
+    TEST_ASSERT_EQUAL(0b00011011, PORTB);
+    TEST_ASSERT_EQUAL(0b01000000, DDRD);
+    TEST_ASSERT_EQUAL(0b10000000, PORTD);
+
+    // Unlisted port shouldn't be changed.
+    TEST_ASSERT_EQUAL(0xFF, DDRC);
+    TEST_ASSERT_EQUAL(0xAA, PORTC);
+
+    // Should be the same as configuring pins one by one.
+    reset_registers();
+    DDRB = 0b00011100;
+    PORTB = 0b00011100;
+    for (uint8_t i = 0; i < sizeof table / sizeof table[0]; i++) {
+        hal_io_configure(table[i].io, table[i].configuration);
+    }
+    TEST_ASSERT_EQUAL(0b00011000, DDRB);
+    TEST_ASSERT_EQUAL(0b00011011, PORTB);
+}
+
+void test_port_errors() {
+    enum hal_io_port port;
+    uint8_t value;
+
+    SKIP_IN_RELEASE_BUILD();
+
+    port = hal_io_port_d + 1;
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_write_port(port, 0xFF));
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_modify_port(port, 0xFF, 0));
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_toggle_port(port, 0xFF));
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_read_port(port, &value));
+}
+
+void test_write_port() {
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_write_port(hal_io_port_b, 0xA5));
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_write_port(hal_io_port_c, 0x3C));
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_write_port(hal_io_port_d, 0xF0));
+
+    TEST_ASSERT_EQUAL(0xA5, PORTB);
+    TEST_ASSERT_EQUAL(0x3C, PORTC);
+    TEST_ASSERT_EQUAL(0xF0, PORTD);
+}
+
+void test_modify_port() {
+    enum hal_result_io result;
+
+    PORTD = 0b10100101;
+
+    result = hal_io_modify_port(hal_io_port_d, 0b00001010, 0b10000001);
+    TEST_ASSERT_EQUAL(hal_result_io_ok, result);
+    TEST_ASSERT_EQUAL(0b00101110, PORTD);
+
+    // Set mask has the priority.
+    result = hal_io_modify_port(hal_io_port_d, 0b00000001, 0b00000011);
+    TEST_ASSERT_EQUAL(hal_result_io_ok, result);
+    TEST_ASSERT_EQUAL(0b00101101, PORTD);
+
+    TEST_ASSERT_EQUAL(0, PORTB);
+    TEST_ASSERT_EQUAL(0, PORTC);
+}
+
+void test_toggle_port() {
+    PORTC = 0xFF;
+
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_toggle_port(hal_io_port_c, 0x81));
+    TEST_ASSERT_EQUAL(0x81, PINC);
+    TEST_ASSERT_EQUAL(0xFF, PORTC);
+}
+
+void test_read_port() {
+    enum hal_io_port port;
+    uint8_t value;
+
+    PINB = 0x12;
+    PINC = 0x34;
+    PIND = 0x56;
+
+    for (port = hal_io_port_b; port <= hal_io_port_d; port++) {
+        TEST_ASSERT_EQUAL(hal_result_io_ok, hal_io_read_port(port, &value));
+        TEST_ASSERT_EQUAL(0x12 + 0x22 * port, value);
+    }
+}
+
+void test_bus_errors() {
+    struct hal_io_pin pins[9] = {{hal_io_port_b, 0}};
+    struct hal_io_bus bus;
+
+    // Checked in release builds too.
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin,
+                      hal_io_bus_init(&bus, pins, 9, NULL));
+
+    pins[1].pin = 8;
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin,
+                      hal_io_bus_init(&bus, pins, 2, NULL));
+
+    pins[1].pin = 1;
+    pins[1].port = hal_io_port_d + 1;
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_bus_init(&bus, pins, 2, NULL));
+
+    // Same pin can't be used twice.
+    pins[1].port = hal_io_port_b;
+    pins[2] = pins[0];
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin,
+                      hal_io_bus_init(&bus, pins, 3, NULL));
+
+    // Strobe pin can't be a data pin.
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_pin,
+                      hal_io_bus_init(&bus, pins, 2, &pins[1]));
+    TEST_ASSERT_EQUAL(0, DDRB);
+}
+
+void test_bus_split() {
+    struct hal_io_pin pins[8] = {
+        {hal_io_port_d, 2}, {hal_io_port_d, 3}, {hal_io_port_d, 4},
+        {hal_io_port_d, 5}, {hal_io_port_d, 6}, {hal_io_port_d, 7},
+        {hal_io_port_b, 0}, {hal_io_port_b, 1},
+    };
+    struct hal_io_pin strobe = {hal_io_port_b, 2};
+    struct hal_io_bus bus;
+
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_bus_init(&bus, pins, 8, &strobe));
+    TEST_ASSERT_EQUAL(2, bus.port_count);
+    TEST_ASSERT_EQUAL(2, bus.segment_count);
+    TEST_ASSERT_EQUAL(1 << 2, DDRB);
+
+    // 500 ns at 16 MHz.
+    TEST_ASSERT_EQUAL(8, bus.strobe_width);
+    hal_io_bus_set_strobe_width(&bus, 20);
+    TEST_ASSERT_EQUAL(20, bus.strobe_width);
+
+    hal_io_bus_set_direction(&bus, hal_io_direction_output);
+    TEST_ASSERT_EQUAL(0b11111100, DDRD);
+    TEST_ASSERT_EQUAL(0b00000111, DDRB);
+
+    // Other pins of the ports shouldn't be changed.
+    PORTD = 0b00000011;
+    PORTB = 0b10000000;
+
+    hal_io_bus_write(&bus, 0xA5);
+    TEST_ASSERT_EQUAL(0b10010111, PORTD);
+    TEST_ASSERT_EQUAL(0b10000010, PORTB);
+    TEST_ASSERT_EQUAL(1 << 2, PINB);
+
+    // Strobe is toggled via PINB, which would overwrite the mock-up input
+    // value.
+    bus.strobe_register = NULL;
+    PIND = 0b01011011;
+    PINB = 0b11111101;
+    TEST_ASSERT_EQUAL(0b01010110, hal_io_bus_read(&bus));
+
+    hal_io_bus_set_direction(&bus, hal_io_direction_input);
+    TEST_ASSERT_EQUAL(0, DDRD);
+    TEST_ASSERT_EQUAL(1 << 2, DDRB);
+    TEST_ASSERT_EQUAL(0b00000011, PORTD);
+    TEST_ASSERT_EQUAL(0b10000000, PORTB);
+}
+
+void test_bus_scrambled() {
+    struct hal_io_pin pins[8] = {
+        {hal_io_port_c, 3}, {hal_io_port_b, 7}, {hal_io_port_b, 6},
+        {hal_io_port_c, 0}, {hal_io_port_c, 1}, {hal_io_port_d, 0},
+        {hal_io_port_b, 4}, {hal_io_port_b, 5},
+    };
+    struct hal_io_bus bus;
+    uint16_t data;
+
+    TEST_ASSERT_EQUAL(hal_result_io_ok, hal_io_bus_init(&bus, pins, 8, NULL));
+    TEST_ASSERT_EQUAL(3, bus.port_count);
+    TEST_ASSERT_EQUAL(6, bus.segment_count);
+
+    for (data = 0; data <= 0xFF; data++) {
+        hal_io_bus_write(&bus, data);
+
+        // Loop back outputs to the inputs.
+        PINB = PORTB;
+        PINC = PORTC;
+        PIND = PORTD;
+
+        TEST_ASSERT_EQUAL(data, hal_io_bus_read(&bus));
+        TEST_ASSERT_EQUAL((data >> 0) & 1, (PORTC >> 3) & 1);
+        TEST_ASSERT_EQUAL((data >> 1) & 1, (PORTB >> 7) & 1);
+        TEST_ASSERT_EQUAL((data >> 5) & 1, (PORTD >> 0) & 1);
+        TEST_ASSERT_EQUAL((data >> 6) & 3, (PORTB >> 4) & 3);
+    }
+}
+
+void test_bitstream() {
+    const uint8_t data[] = {0xA5, 0x0F};
+
+#if !defined(HAL_RELEASE_BUILD)
+    TEST_ASSERT_EQUAL(
+        hal_result_io_error_invalid_port,
+        hal_io_bitstream_write((struct hal_io_pin){hal_io_port_d + 1, 0}, data,
+                               sizeof data));
+    TEST_ASSERT_EQUAL(
+        hal_result_io_error_invalid_pin,
+        hal_io_bitstream_write((struct hal_io_pin){hal_io_port_b, 8}, data,
+                               sizeof data));
+#endif // HAL_RELEASE_BUILD
+
+    // Nothing is written for an empty frame.
+    PORTB = 0xFF;
+    TEST_ASSERT_EQUAL(
+        hal_result_io_ok,
+        hal_io_bitstream_write((struct hal_io_pin){hal_io_port_b, 0}, data, 0));
+    TEST_ASSERT_EQUAL(0xFF, PORTB);
+
+    // Line is left low, while other pins of the port are kept.
+    TEST_ASSERT_EQUAL(
+        hal_result_io_ok,
+        hal_io_bitstream_write((struct hal_io_pin){hal_io_port_b, 3}, data,
+                               sizeof data));
+    TEST_ASSERT_EQUAL(0b11110111, PORTB);
+}
+
+void test_debouncer() {
+    struct hal_io_debouncer debouncer;
+    uint8_t i;
+
+#if !defined(HAL_RELEASE_BUILD)
+    TEST_ASSERT_EQUAL(hal_result_io_error_invalid_port,
+                      hal_io_debouncer_init(&debouncer, hal_io_port_d + 1, 0));
+#endif // HAL_RELEASE_BUILD
+
+    // Pins 0-3 are active high and pins 4-7 are active low. Pin 7 is active
+    // from the start.
+    PINC = 0b01110000;
+    TEST_ASSERT_EQUAL(hal_result_io_ok,
+                      hal_io_debouncer_init(&debouncer, hal_io_port_c, 0xF0));
+    TEST_ASSERT_EQUAL(0b10000000, hal_io_debouncer_get_state(&debouncer));
+
+    // Press pins 0 and 4, while pin 1 bounces.
+    for (i = 0; i < 3; i++) {
+        PINC = 0b01100001 | (i & 1) << 1;
+        hal_io_debouncer_tick(&debouncer);
+        TEST_ASSERT_EQUAL(0b10000000, hal_io_debouncer_get_state(&debouncer));
+        TEST_ASSERT_EQUAL(0, hal_io_debouncer_get_pressed(&debouncer, 0xFF));
+    }
+    PINC = 0b01100001;
+    hal_io_debouncer_tick(&debouncer);
+    TEST_ASSERT_EQUAL(0b10010001, hal_io_debouncer_get_state(&debouncer));
+
+    // Edges are kept until they are read.
+    hal_io_debouncer_tick(&debouncer);
+    TEST_ASSERT_EQUAL(0b00000001,
+                      hal_io_debouncer_get_pressed(&debouncer, 0b00001111));
+    TEST_ASSERT_EQUAL(0b00010000,
+                      hal_io_debouncer_get_pressed(&debouncer, 0xFF));
+    TEST_ASSERT_EQUAL(0, hal_io_debouncer_get_pressed(&debouncer, 0xFF));
+    TEST_ASSERT_EQUAL(0, hal_io_debouncer_get_released(&debouncer, 0xFF));
+
+    // Release pins 0 and 7.
+    PINC = 0b11100000;
+    for (i = 0; i < 4; i++) {
+        hal_io_debouncer_tick(&debouncer);
+    }
+    TEST_ASSERT_EQUAL(0b00010000, hal_io_debouncer_get_state(&debouncer));
+    TEST_ASSERT_EQUAL(0b10000001,
+                      hal_io_debouncer_get_released(&debouncer, 0xFF));
+    TEST_ASSERT_EQUAL(0, hal_io_debouncer_get_pressed(&debouncer, 0xFF));
+}
+
+/**
+ * Pin descriptors for the fast path tests.
+ */
+#define FAST_PIN_B5 hal_io_port_b, 5
+#define FAST_PIN_C0 hal_io_port_c, 0
+#define FAST_PIN_D7 hal_io_port_d, 7
+
+void test_fast_write() {
+    hal_io_fast_high(FAST_PIN_B5);
+    TEST_ASSERT_EQUAL(1 << 5, PORTB);
+
+    hal_io_fast_high(FAST_PIN_D7);
+    TEST_ASSERT_EQUAL(1 << 7, PORTD);
+    TEST_ASSERT_EQUAL(1 << 5, PORTB);
+
+    hal_io_fast_low(FAST_PIN_B5);
+    TEST_ASSERT_EQUAL(0, PORTB);
+    TEST_ASSERT_EQUAL(1 << 7, PORTD);
+
+    hal_io_fast_write(FAST_PIN_C0, hal_io_state_high);
+    TEST_ASSERT_EQUAL(1 << 0, PORTC);
+
+    hal_io_fast_write(FAST_PIN_C0, hal_io_state_low);
+    TEST_ASSERT_EQUAL(0, PORTC);
+}
+
+void test_fast_toggle() {
+    // Only the toggled pin is written, even if others read high.
+    PINB = 1 << 0;
+    hal_io_fast_toggle(FAST_PIN_B5);
+    TEST_ASSERT_EQUAL(1 << 5, PINB);
+
+    hal_io_fast_toggle(FAST_PIN_D7);
+    TEST_ASSERT_EQUAL(1 << 7, PIND);
+    TEST_ASSERT_EQUAL(0, PORTD);
+}
+
+void test_fast_read() {
+    TEST_ASSERT_EQUAL(hal_io_state_low, hal_io_fast_read(FAST_PIN_C0));
+
+    PINC = 1 << 0;
+    TEST_ASSERT_EQUAL(hal_io_state_high, hal_io_fast_read(FAST_PIN_C0));
+    TEST_ASSERT_EQUAL(hal_io_state_low, hal_io_fast_read(FAST_PIN_D7));
+}
+
+void test_fast_pin() {
+    struct hal_io_pin io_pin = hal_io_fast_pin(FAST_PIN_D7);
+
+    TEST_ASSERT_EQUAL(hal_io_port_d, io_pin.port);
+    TEST_ASSERT_EQUAL(7, io_pin.pin);
+}
+
 int main() {
     RUN_TEST(test_errors);
 
@@ -385,6 +761,27 @@ int main() {
     RUN_TEST(test_write_single);
     RUN_TEST(test_write_multi);
 
+    RUN_TEST(test_configure_many_errors);
+    RUN_TEST(test_configure_many);
+
+    RUN_TEST(test_port_errors);
+    RUN_TEST(test_write_port);
+    RUN_TEST(test_modify_port);
+    RUN_TEST(test_toggle_port);
+    RUN_TEST(test_read_port);
+
+    RUN_TEST(test_bus_errors);
+    RUN_TEST(test_bus_split);
+    RUN_TEST(test_bus_scrambled);
+
+    RUN_TEST(test_bitstream);
+    RUN_TEST(test_debouncer);
+
+    RUN_TEST(test_fast_write);
+    RUN_TEST(test_fast_toggle);
+    RUN_TEST(test_fast_read);
+    RUN_TEST(test_fast_pin);
+
     return UnityEnd();
 }
 
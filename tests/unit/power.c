@@ -19,16 +19,16 @@ void test_sleep_mode() {
     enum hal_power_sleep_modes mode;
     for (mode = hal_power_idle_mode; mode <= hal_power_external_standby_mode;
          mode++) {
-        int ret = hal_power_set_sleep_mode(mode);
-
         // For illegal values between the max and min values, check if it
         // errors out.
-        if (mode != 4 && mode != 5) {
-            TEST_ASSERT_EQUAL(ret, 0);
-        } else {
-            TEST_ASSERT_EQUAL(ret, hal_result_power_illegal_mode);
+        if (mode == 4 || mode == 5) {
+#if !defined(HAL_RELEASE_BUILD)
+            TEST_ASSERT_EQUAL(hal_power_set_sleep_mode(mode),
+                              hal_result_power_illegal_mode);
+#endif // HAL_RELEASE_BUILD
             continue;
         }
+        TEST_ASSERT_EQUAL(hal_power_set_sleep_mode(mode), 0);
 
         // Test if enum value is same as the register value.
         TEST_ASSERT_EQUAL(mode << 1, SMCR & 0b1110);
@@ -42,6 +42,7 @@ void test_power_set_sleep_mode_incorrect_input() {
     enum hal_power_sleep_modes incorrect_mode;
     incorrect_mode = (1 << 8) - 1;
 
+    SKIP_IN_RELEASE_BUILD();
     TEST_ASSERT_EQUAL(0, SMCR);
 
     uint8_t initial_value = SMCR;
@@ -59,8 +60,10 @@ void test_module_power_single() {
     enum hal_power_modules i;
     for (i = 0; i < 8; i++) {
         if (i == 4) {
+#if !defined(HAL_RELEASE_BUILD)
             TEST_ASSERT_EQUAL(hal_result_power_module_not_found,
                               hal_power_set_module_power(i, 1));
+#endif // HAL_RELEASE_BUILD
             continue;
         }
 
@@ -85,8 +88,10 @@ void test_module_power_without_reset() {
     enum hal_power_modules i;
     for (i = 0; i < 8; i++) {
         if (i == 4) {
+#if !defined(HAL_RELEASE_BUILD)
             TEST_ASSERT_EQUAL(hal_result_power_module_not_found,
                               hal_power_set_module_power(i, 1));
+#endif // HAL_RELEASE_BUILD
             continue;
         }
 
@@ -105,8 +110,10 @@ void test_module_power_without_reset() {
     // Start from last.
     for (i = 0; i < 8; i++) {
         if (i == 3) {
+#if !defined(HAL_RELEASE_BUILD)
             TEST_ASSERT_EQUAL(hal_result_power_module_not_found,
                               hal_power_set_module_power(7 - i, 1));
+#endif // HAL_RELEASE_BUILD
             continue;
         }
 
@@ -125,6 +132,8 @@ void test_module_power_without_reset() {
 void test_change_module_powers_reserved_value() {
     uint8_t power_off, power_on;
 
+    SKIP_IN_RELEASE_BUILD();
+
     power_off = BIT(4);
     power_on = 0;
     TEST_ASSERT_EQUAL(1, hal_power_change_module_powers(power_off, power_on));
@@ -141,6 +150,8 @@ void test_change_module_powers_reserved_value() {
 void test_change_module_powers_same_bit() {
     int i;
 
+    SKIP_IN_RELEASE_BUILD();
+
     for (i = 0; i < 1 << 8; i++) {
         if (i & BIT(4)) {
             continue;
@@ -50,7 +50,11 @@ void test_set_cycles() {
         config.cycles = hal_system_watchdog_2k_cycles + i;
         TEST_ASSERT_EQUAL(hal_result_system_ok,
                           hal_system_set_watchdog(config));
-        TEST_ASSERT_EQUAL(config.cycles, WDTCSR & 0b1111);
+
+        // WDP3 is bit 5, after WDE.
+        TEST_ASSERT_EQUAL((i & 0b111) | (i & 0b1000) << 2,
+                          WDTCSR & (BIT(WDP3) | 0b111));
+        TEST_ASSERT_EQUAL(0, WDTCSR & BIT(WDE));
     }
 }
 
@@ -60,6 +64,8 @@ void test_invalid_configuration() {
     config.mode = hal_system_watchdog_interrupt_mode;
     TEST_ASSERT_EQUAL(hal_result_system_ok, hal_system_set_watchdog(config));
 
+    SKIP_IN_RELEASE_BUILD();
+
     config.cycles = hal_system_watchdog_1024k_cycles + 1;
     TEST_ASSERT_EQUAL(hal_result_system_invalid_watchdog_cycles,
                       hal_system_set_watchdog(config));
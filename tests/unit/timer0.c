@@ -8,6 +8,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "hal_internals.h"
+#include "hal_power.h"
 #include "hal_timer0.h"
 
 #include "test_mock_up.h"
@@ -15,6 +16,12 @@
 #include "unity.h"
 
 #include <avr/io.h>
+#include <string.h>
+
+static uint8_t compare_a_calls;
+
+static inline void on_compare_a(void) { compare_a_calls++; }
+HAL_TIMER0_COMPA_ISR(on_compare_a)
 
 void basic_set_and_get_timer0_counter() {
     uint8_t val;
@@ -33,9 +40,11 @@ void basic_set_and_get_timer0_counter() {
 void set_operation_mode() {
     enum hal_timer0_operation_modes mode;
 
+#if !defined(HAL_RELEASE_BUILD)
     mode = hal_timer0_mode_normal - 1;
     TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
                       hal_result_timer0_invalid_operation_mode);
+#endif // HAL_RELEASE_BUILD
 
     mode = hal_timer0_mode_normal;
     TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
@@ -48,6 +57,54 @@ void set_operation_mode() {
                       hal_result_timer0_ok);
     TEST_ASSERT_EQUAL(TCCR0A, 0b10);
     TEST_ASSERT_EQUAL(TCCR0B, 0);
+
+    mode = hal_timer0_mode_fast_pwm;
+    TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(TCCR0A, 0b11);
+    TEST_ASSERT_EQUAL(TCCR0B, 0);
+
+    mode = hal_timer0_mode_phase_correct_pwm;
+    TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(TCCR0A, 0b01);
+    TEST_ASSERT_EQUAL(TCCR0B, 0);
+
+    mode = hal_timer0_mode_fast_pwm_ocr0a_top;
+    TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(TCCR0A, 0b11);
+    TEST_ASSERT_EQUAL(TCCR0B, 1 << WGM02);
+
+    mode = hal_timer0_mode_phase_correct_pwm_ocr0a_top;
+    TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(TCCR0A, 0b01);
+    TEST_ASSERT_EQUAL(TCCR0B, 1 << WGM02);
+
+#if !defined(HAL_RELEASE_BUILD)
+    mode = hal_timer0_mode_phase_correct_pwm_ocr0a_top + 1;
+    TEST_ASSERT_EQUAL(hal_timer0_set_operation_mode(mode),
+                      hal_result_timer0_invalid_operation_mode);
+#endif // HAL_RELEASE_BUILD
+}
+
+void test_set_output_compare_value() {
+    TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_value(
+                          hal_timer0_output_compare_register_a, 0x40),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_value(
+                          hal_timer0_output_compare_register_b, 0xC0),
+                      hal_result_timer0_ok);
+    TEST_ASSERT_EQUAL(OCR0A, 0x40);
+    TEST_ASSERT_EQUAL(OCR0B, 0xC0);
+
+#if !defined(HAL_RELEASE_BUILD)
+    TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_value(
+                          hal_timer0_output_compare_register_b + 1, 0x00),
+                      hal_result_timer0_invalid_output_compare_register);
+    TEST_ASSERT_EQUAL(OCR0B, 0xC0);
+#endif // HAL_RELEASE_BUILD
 }
 
 /// @brief Try to change COM0A* bits and check if operation is successful or
@@ -78,7 +135,6 @@ void set_and_test(enum hal_timer0_output_compare_register reg,
     TEST_ASSERT_EQUAL(TCCR0A & initial_val, initial_val);
 }
 void test_set_output_compare_mode() {
-    enum hal_timer0_output_compare_mode mode;
     enum hal_timer0_output_compare_register reg;
 
     // Initial value shouldn't be changed, except COM0A* bits.
@@ -89,13 +145,17 @@ void test_set_output_compare_mode() {
         printf("Testing OCR: %d\n", reg);
         TCCR0A = initial_val;
 
+#if !defined(HAL_RELEASE_BUILD)
         // Invalid modes should return error.
+        enum hal_timer0_output_compare_mode mode;
+
         mode = hal_timer0_compare_output_mode_set + 1;
         TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_mode(reg, mode),
                           hal_result_timer0_invalid_output_compare_mode);
         mode = hal_timer0_compare_output_mode_normal - 1;
         TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_mode(reg, mode),
                           hal_result_timer0_invalid_output_compare_mode);
+#endif // HAL_RELEASE_BUILD
 
         set_and_test(reg, hal_timer0_compare_output_mode_normal, 0b00,
                      initial_val);
@@ -120,9 +180,11 @@ void test_set_output_compare_register_wrong() {
     TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_mode(
                           hal_timer0_output_compare_register_b, mode),
                       hal_result_timer0_ok);
+#if !defined(HAL_RELEASE_BUILD)
     TEST_ASSERT_EQUAL(hal_timer0_set_output_compare_mode(
                           hal_timer0_output_compare_register_b + 1, mode),
                       hal_result_timer0_invalid_output_compare_register);
+#endif // HAL_RELEASE_BUILD
 }
 
 void test_set_clock_source_invalid() {
@@ -134,12 +196,14 @@ void test_set_clock_source_invalid() {
                           hal_result_timer0_ok);
     }
 
+#if !defined(HAL_RELEASE_BUILD)
     source = hal_timer0_stop - 1;
     TEST_ASSERT_EQUAL(hal_timer0_set_clock_source(source),
                       hal_result_timer0_invalid_clock_source);
     source = hal_timer0_external_rising_edge + 1;
     TEST_ASSERT_EQUAL(hal_timer0_set_clock_source(source),
                       hal_result_timer0_invalid_clock_source);
+#endif // HAL_RELEASE_BUILD
 }
 
 void test_set_clock_source() {
@@ -154,13 +218,366 @@ void test_set_clock_source() {
     }
 }
 
+void test_interrupts() {
+    enum hal_timer0_interrupt interrupt;
+
+#if !defined(HAL_RELEASE_BUILD)
+    interrupt = hal_timer0_interrupt_compare_b + 1;
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_interrupt,
+                      hal_timer0_interrupt_enable(interrupt));
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_interrupt,
+                      hal_timer0_interrupt_disable(interrupt));
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_interrupt,
+                      hal_timer0_interrupt_clear(interrupt));
+    TEST_ASSERT_EQUAL(0, TIMSK0);
+#endif // HAL_RELEASE_BUILD
+
+    interrupt = hal_timer0_interrupt_overflow;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok,
+                      hal_timer0_interrupt_enable(interrupt));
+    interrupt = hal_timer0_interrupt_compare_a;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok,
+                      hal_timer0_interrupt_enable(interrupt));
+    TEST_ASSERT_EQUAL(1 << TOIE0 | 1 << OCIE0A, TIMSK0);
+
+    interrupt = hal_timer0_interrupt_overflow;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok,
+                      hal_timer0_interrupt_disable(interrupt));
+    TEST_ASSERT_EQUAL(1 << OCIE0A, TIMSK0);
+
+    interrupt = hal_timer0_interrupt_compare_b;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok,
+                      hal_timer0_interrupt_clear(interrupt));
+    TEST_ASSERT_EQUAL(1 << OCF0B, TIFR0);
+
+    compare_a_calls = 0;
+    TIMER0_COMPA_vect();
+    TIMER0_COMPA_vect();
+    TEST_ASSERT_EQUAL(2, compare_a_calls);
+}
+
+void test_tick() {
+    uint16_t i;
+
+    hal_timer0_tick_init();
+    TEST_ASSERT_EQUAL(1 << TOIE0, TIMSK0 & (1 << TOIE0));
+    TEST_ASSERT_EQUAL(hal_timer0_prescaler_64, TCCR0B & 0b111);
+    TEST_ASSERT_EQUAL(0, hal_timer0_tick_get_millis());
+
+    // Flag is cleared by writing 1 on the hardware.
+    TIFR0 = 0;
+
+    // An overflow is 1024 us at 16 MHz.
+    for (i = 0; i < 1000; i++) {
+        TIMER0_OVF_vect();
+    }
+    TEST_ASSERT_EQUAL(1024, hal_timer0_tick_get_millis());
+
+    TCNT0 = 100;
+    TEST_ASSERT_EQUAL(1024000 + 400, hal_timer0_tick_get_micros());
+
+    // Overflow that is not handled yet.
+    TCNT0 = 2;
+    TIFR0 |= 1 << TOV0;
+    TEST_ASSERT_EQUAL(1024000 + 1024 + 8, hal_timer0_tick_get_micros());
+
+    // Flag belongs to the next count, if the count is still at the top.
+    TCNT0 = 0xFF;
+    TEST_ASSERT_EQUAL(1024000 + 1020, hal_timer0_tick_get_micros());
+}
+
+static uint8_t alarms;
+static uint32_t alarm_at;
+
+static void on_alarm() {
+    alarms++;
+    alarm_at = hal_timer0_tick_get_counts();
+}
+
+void test_tick_modes() {
+    // Tick needs 256 counts in each overflow period.
+    TCCR0A = 1 << WGM01;
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_operation_mode,
+                      hal_timer0_tick_init());
+    TEST_ASSERT_EQUAL(0, TIMSK0);
+    TCCR0A = 1 << WGM00;
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_operation_mode,
+                      hal_timer0_tick_init());
+    TCCR0A = 1 << WGM01 | 1 << WGM00;
+    TCCR0B = 1 << WGM02;
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_operation_mode,
+                      hal_timer0_tick_init());
+    TEST_ASSERT_EQUAL(0, TIMSK0);
+
+    TCCR0B = 0;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok, hal_timer0_tick_init());
+    TCCR0A = 0;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok, hal_timer0_tick_init());
+
+    // Alarm is not set, if the mode is changed afterwards.
+    TCCR0A = 1 << WGM00;
+    TEST_ASSERT_EQUAL(hal_result_timer0_invalid_operation_mode,
+                      hal_timer0_tick_set_alarm(100, on_alarm));
+    TEST_ASSERT_EQUAL(0, TIMSK0 & 1 << OCIE0B);
+    TCCR0A = 0;
+    TEST_ASSERT_EQUAL(hal_result_timer0_ok,
+                      hal_timer0_tick_set_alarm(100, on_alarm));
+    TEST_ASSERT_EQUAL(1 << OCIE0B, TIMSK0 & 1 << OCIE0B);
+    hal_timer0_tick_cancel_alarm();
+}
+
+/// @brief Number of output compare B interrupts taken by run_timer0().
+static uint16_t compare_b_interrupts;
+
+/// @brief Output compare B value in use. It's double buffered in the PWM
+/// modes, and OCR0B is taken at the bottom.
+static uint8_t compare_b;
+
+/// @brief Count timer0 like the hardware, taking its interrupts.
+/// @param counts Number of counts to run.
+static void run_timer0(uint32_t counts) {
+    while (counts--) {
+        TCNT0++;
+        if (TCNT0 == 0 && (TCCR0A & 1 << WGM00)) {
+            compare_b = OCR0B;
+        }
+        if (TCNT0 == 0 && (TIMSK0 & 1 << TOIE0)) {
+            TIMER0_OVF_vect();
+        }
+        if (!(TCCR0A & 1 << WGM00)) {
+            compare_b = OCR0B;
+        }
+        if ((TIMSK0 & 1 << OCIE0B) && TCNT0 == compare_b) {
+            compare_b_interrupts++;
+            TIMER0_COMPB_vect();
+        }
+    }
+}
+
+static uint8_t fired[4];
+static uint32_t fired_at[4];
+
+static struct hal_timer0_timer timers[4];
+
+static void on_timer(struct hal_timer0_timer *timer) {
+    fired[timer - timers]++;
+    fired_at[timer - timers] = hal_timer0_tick_get_counts();
+}
+
+void test_timers() {
+    hal_timer0_tick_init();
+    TIFR0 = 0;
+    compare_b_interrupts = 0;
+
+    // 250 counts in a millisecond at 16 MHz.
+    hal_timer0_timer_start(&timers[0], 10, 0, on_timer);
+    hal_timer0_timer_start(&timers[1], 3, 5, on_timer);
+    hal_timer0_timer_start(&timers[2], 200, 0, on_timer);
+    hal_timer0_timer_start(&timers[3], 5, 0, on_timer);
+    hal_timer0_timer_stop(&timers[3]);
+    TEST_ASSERT_FALSE(hal_timer0_timer_is_running(&timers[3]));
+
+    run_timer0(30 * 250L);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_EQUAL(2500, fired_at[0]);
+    TEST_ASSERT_EQUAL(6, fired[1]);
+    TEST_ASSERT_EQUAL(7000, fired_at[1]);
+    TEST_ASSERT_EQUAL(0, fired[2]);
+    TEST_ASSERT_EQUAL(0, fired[3]);
+    TEST_ASSERT_FALSE(hal_timer0_timer_is_running(&timers[0]));
+    TEST_ASSERT_TRUE(hal_timer0_timer_is_running(&timers[1]));
+
+    // Compare interrupt runs only when a timer expires.
+    TEST_ASSERT_EQUAL(7, compare_b_interrupts);
+
+    // Timer of a later turn of the wheel.
+    hal_timer0_timer_stop(&timers[1]);
+    run_timer0(200 * 250L);
+    TEST_ASSERT_EQUAL(1, fired[2]);
+    TEST_ASSERT_EQUAL(50000, fired_at[2]);
+    TEST_ASSERT_EQUAL(0, TIMSK0 & 1 << OCIE0B);
+}
+
+void test_timers_fast_pwm() {
+    TCCR0A = 1 << WGM01 | 1 << WGM00;
+    hal_timer0_tick_init();
+    TIFR0 = 0;
+    compare_b_interrupts = 0;
+    memset(fired, 0, sizeof(fired));
+
+    // Compare unit is armed in the overflow period before each expiry, so
+    // timers fire on time, like in normal mode.
+    hal_timer0_timer_start(&timers[0], 10, 0, on_timer);
+    hal_timer0_timer_start(&timers[1], 3, 5, on_timer);
+    run_timer0(30 * 250L);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_EQUAL(2500, fired_at[0]);
+    TEST_ASSERT_EQUAL(6, fired[1]);
+    TEST_ASSERT_EQUAL(7000, fired_at[1]);
+    TEST_ASSERT_EQUAL(7, compare_b_interrupts);
+    hal_timer0_timer_stop(&timers[1]);
+
+    // Alarm of the stopped timer finds nothing to expire. Then the alarm is
+    // free to be set directly.
+    run_timer0(5 * 250L);
+    TEST_ASSERT_EQUAL(8, compare_b_interrupts);
+
+    // Alarm in its own overflow period fires right after the next overflow,
+    // from the compare interrupt.
+    alarms = 0;
+    run_timer0(0x100 - TCNT0 + 10);
+    hal_timer0_tick_set_alarm(hal_timer0_tick_get_counts() + 100, on_alarm);
+    run_timer0(0x100);
+    TEST_ASSERT_EQUAL(1, alarms);
+    TEST_ASSERT_EQUAL(2, alarm_at & 0xFF);
+    TEST_ASSERT_EQUAL(9, compare_b_interrupts);
+
+    // Alarm at the start of a period fires as soon as the overflow interrupt
+    // can arm it.
+    hal_timer0_tick_set_alarm((hal_timer0_tick_get_counts() | 0xFF) + 0x202,
+                              on_alarm);
+    run_timer0(0x400);
+    TEST_ASSERT_EQUAL(2, alarms);
+    TEST_ASSERT_EQUAL(2, alarm_at & 0xFF);
+    TEST_ASSERT_EQUAL(10, compare_b_interrupts);
+
+    // Alarm at the middle of a later period fires right on time.
+    hal_timer0_tick_set_alarm((hal_timer0_tick_get_counts() | 0xFF) + 0x181,
+                              on_alarm);
+    run_timer0(0x400);
+    TEST_ASSERT_EQUAL(3, alarms);
+    TEST_ASSERT_EQUAL(0x80, alarm_at & 0xFF);
+}
+
+/// @brief Sleep mode and watchdog control of the last sleep, and whether the
+/// watchdog wakes up the CPU.
+static uint8_t sleep_mode;
+static uint8_t sleep_watchdog;
+static uint8_t is_watchdog_waking;
+
+void sleep_callback() {
+    sleep_mode = SMCR >> 1 & 0b111;
+    sleep_watchdog = WDTCSR;
+    if (is_watchdog_waking && (WDTCSR & 1 << WDIE)) {
+        WDT_vect();
+    }
+}
+
+void test_idle() {
+    uint32_t start;
+
+    hal_timer0_tick_init();
+    TIFR0 = 0;
+    is_watchdog_waking = 1;
+    memset(fired, 0, sizeof(fired));
+
+    // Peripherals without drivers are taken as running.
+    hal_timer0_timer_start(&timers[0], 100, 0, on_timer);
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_idle_mode, sleep_mode);
+    TEST_ASSERT_EQUAL(0, hal_timer0_tick_get_counts());
+
+    // 64 ms and 32 ms of the watchdog fit in 100 ms.
+    PRR = 1 << PRADC | 1 << PRSPI | 1 << PRTWI;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_power_down_mode, sleep_mode);
+    TEST_ASSERT_EQUAL(0, WDTCSR);
+    TEST_ASSERT_EQUAL(16000, hal_timer0_tick_get_counts());
+    // Milliseconds are counted on overflows, 62 of them so far.
+    TEST_ASSERT_EQUAL(63, hal_timer0_tick_get_millis());
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(24000, hal_timer0_tick_get_counts());
+    TEST_ASSERT_EQUAL(95, hal_timer0_tick_get_millis());
+
+    // Rest is shorter than the watchdog, timer0 wakes up the CPU.
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_idle_mode, sleep_mode);
+    run_timer0(1000);
+    TEST_ASSERT_EQUAL(1, fired[0]);
+    TEST_ASSERT_EQUAL(25000, fired_at[0]);
+
+    // If another interrupt wakes up the CPU, watchdog keeps running and CPU
+    // sleeps until it fires. Then the time that timer0 didn't count is added.
+    hal_timer0_timer_start(&timers[0], 1000, 0, on_timer);
+    is_watchdog_waking = 0;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_power_down_mode, sleep_mode);
+    TEST_ASSERT_EQUAL(25000, hal_timer0_tick_get_counts());
+    run_timer0(100);
+
+    // Watchdog is not started again, which would clear its flag.
+    WDTCSR |= 1 << WDIF;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_power_down_mode, sleep_mode);
+    TEST_ASSERT_EQUAL(1 << WDIF, sleep_watchdog & 1 << WDIF);
+    WDT_vect();
+    TEST_ASSERT_EQUAL(0, WDTCSR);
+    TEST_ASSERT_EQUAL(25000 + 128000, hal_timer0_tick_get_counts());
+
+    // Watchdog of an earlier sleep, that fires after the deadline, is left to
+    // run in idle mode.
+    hal_timer0_idle();
+    hal_timer0_timer_start(&timers[1], 20, 0, on_timer);
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_idle_mode, sleep_mode);
+    hal_timer0_timer_stop(&timers[1]);
+    is_watchdog_waking = 1;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(0, WDTCSR);
+
+    // Alarm of the stopped timer has passed, it finds nothing to expire.
+    run_timer0(2);
+    TEST_ASSERT_EQUAL(0, fired[1]);
+
+    // USART and synchronous timer2 need the I/O clock.
+    UCSR0B = 1 << TXEN0;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_idle_mode, sleep_mode);
+    UCSR0B = 0;
+
+    TCCR2B = 1 << CS20;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_idle_mode, sleep_mode);
+    ASSR = 1 << AS2;
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_power_save_mode, sleep_mode);
+    hal_timer0_timer_stop(&timers[0]);
+
+    // Alarm of the stopped timer is still set, sleep until it passes.
+    TCCR2B = 0;
+    ASSR = 0;
+    is_watchdog_waking = 1;
+    do {
+        hal_timer0_idle();
+    } while (sleep_mode == hal_power_power_down_mode);
+    run_timer0(4000);
+
+    // 8 s of the watchdog fit in 10 s, its WDP3 bit is not next to the others.
+    hal_timer0_timer_start(&timers[0], 10000, 0, on_timer);
+    start = hal_timer0_tick_get_counts();
+    hal_timer0_idle();
+    TEST_ASSERT_EQUAL(hal_power_power_down_mode, sleep_mode);
+    TEST_ASSERT_EQUAL(1 << WDP3 | 1 << WDP0,
+                      sleep_watchdog & (1 << WDP3 | 0b111));
+    TEST_ASSERT_EQUAL(0, sleep_watchdog & 1 << WDE);
+    TEST_ASSERT_EQUAL(start + 2048000, hal_timer0_tick_get_counts());
+    hal_timer0_timer_stop(&timers[0]);
+}
+
 int main() {
     RUN_TEST(basic_set_and_get_timer0_counter);
     RUN_TEST(set_operation_mode);
     RUN_TEST(test_set_output_compare_mode);
     RUN_TEST(test_set_output_compare_register_wrong);
+    RUN_TEST(test_set_output_compare_value);
     RUN_TEST(test_set_clock_source_invalid);
     RUN_TEST(test_set_clock_source);
+    RUN_TEST(test_interrupts);
+    RUN_TEST(test_tick);
+    RUN_TEST(test_tick_modes);
+    RUN_TEST(test_timers);
+    RUN_TEST(test_timers_fast_pwm);
+    RUN_TEST(test_idle);
 
     return UnityEnd();
 }
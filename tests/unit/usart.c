@@ -12,6 +12,11 @@
 #include "unity.h"
 
 #include <avr/io.h>
+#include <stdio.h>
+#include <string.h>
+
+// Receive complete interrupt of the driver, called directly by some tests.
+void USART_RX_vect(void);
 
 /**
  * Sets necessary data for initializing.
@@ -104,7 +109,7 @@ void test_synchronous_master() {
 
     TEST_ASSERT_EQUAL(usart_success, result);
 
-    TEST_ASSERT_EQUAL(1 << UMSEL01, UCSR0C & ((1 << UMSEL00) | (1 << UMSEL01)));
+    TEST_ASSERT_EQUAL(1 << UMSEL00, UCSR0C & ((1 << UMSEL00) | (1 << UMSEL01)));
     TEST_ASSERT_EQUAL(0, UCSR0A & (1 << U2X0));
 }
 
@@ -122,6 +127,10 @@ void test_stop_bits_legal() {
 }
 
 void test_stop_bits_illegal() {
+    SKIP_IN_RELEASE_BUILD();
+
+    // Invalid constant arguments don't compile in release builds.
+#if !defined(HAL_RELEASE_BUILD)
     struct usart_t usart;
     enum usart_result result;
 
@@ -132,6 +141,837 @@ void test_stop_bits_illegal() {
     result = usart_init(&usart);
 
     TEST_ASSERT_EQUAL(usart_error, result);
+#endif // HAL_RELEASE_BUILD
+}
+
+/**
+ * Initializes USART at 115200 bps, 8N1, with the USART model enabled. A frame
+ * is 10 bits of 144 cycles at 16 MHz.
+ */
+#define FRAME_CYCLES 1440
+
+/**
+ * Each access of the USART registers takes 2 cycles in the model, and the
+ * code between them takes none. So delays of the driver are counted in
+ * register accesses, this is 4 of them.
+ */
+#define ACCESS_CYCLES_MAX 8
+
+static void init_model() {
+    struct usart_t usart = {
+        .baud_rate = 115200,
+        .data_bits = 8,
+        .stop_bits = 1,
+        .direction = usart_direction_transmit_and_receive,
+        .mode = usart_mode_asynchronous_normal,
+        .parity = usart_parity_disabled,
+    };
+
+    TEST_ASSERT_EQUAL(usart_success, usart_init(&usart));
+    mock_usart_enable();
+}
+
+/**
+ * Blocking transmit keeps the transmit buffer full, so bytes are back to back.
+ */
+void test_model_transmit_throughput() {
+    struct usart_t usart;
+    const struct mock_usart_byte *bytes;
+    uint8_t data[64];
+    uint16_t i, count;
+
+    init_model();
+    for (i = 0; i < sizeof data; i++) {
+        data[i] = i;
+    }
+
+    usart_transmit(&usart, data, sizeof data);
+    mock_advance(2 * FRAME_CYCLES);
+
+    count = mock_usart_get_transmitted(&bytes);
+    TEST_ASSERT_EQUAL(sizeof data, count);
+    TEST_ASSERT_UINT32_WITHIN(ACCESS_CYCLES_MAX, 0, bytes[0].start);
+    for (i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(data[i], bytes[i].data);
+        TEST_ASSERT_EQUAL(bytes[0].start + i * FRAME_CYCLES, bytes[i].start);
+    }
+    TEST_ASSERT_TRUE(UCSR0A & (1 << TXC0));
+}
+
+/**
+ * Interrupt driven transmit starts on the next step and leaves no gaps.
+ */
+void test_model_transmit_irq() {
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = "interrupt driven";
+    uint16_t i, count;
+
+    init_model();
+    mock_advance(100);
+
+    TEST_ASSERT_EQUAL(sizeof data, usart_transmit_irq(data, sizeof data));
+    usart_transmit_irq_flush();
+
+    count = mock_usart_get_transmitted(&bytes);
+    TEST_ASSERT_EQUAL(sizeof data, count);
+    TEST_ASSERT_UINT32_WITHIN(ACCESS_CYCLES_MAX, 100, bytes[0].start);
+    for (i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(data[i], bytes[i].data);
+        TEST_ASSERT_EQUAL(bytes[0].start + i * FRAME_CYCLES, bytes[i].start);
+    }
+    TEST_ASSERT_UINT32_WITHIN(ACCESS_CYCLES_MAX, bytes[count - 1].end,
+                              mock_get_time());
+    TEST_ASSERT_EQUAL(0, UCSR0B & (1 << UDRIE0));
+}
+
+/**
+ * A frame with 9 data bits at 115200 bps, 11 bits in total.
+ */
+#define NINE_BIT_FRAME_CYCLES (FRAME_CYCLES / 10 * 11)
+
+/**
+ * Address frames are queued in order with the data, with the 9th bit set, and
+ * take the RS-485 bus like data.
+ */
+void test_model_transmit_irq_address() {
+    struct usart_t usart = {
+        .baud_rate = 115200,
+        .data_bits = 9,
+        .stop_bits = 1,
+        .direction = usart_direction_transmit,
+        .mode = usart_mode_asynchronous_normal,
+        .parity = usart_parity_disabled,
+    };
+    struct hal_io_pin driver_enable = {hal_io_port_d, 2};
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = {0xA0, 0xA1};
+    const uint8_t expected[] = {0xA0, 0xA1, 0x12, 0xA0, 0xA1, 0x34, 0x56, 0xA0};
+    const uint8_t ninth_bits[] = {0, 0, 1, 0, 0, 1, 1, 0};
+    uint16_t i, count;
+
+    TEST_ASSERT_EQUAL(usart_success, usart_init(&usart));
+    mock_usart_enable();
+    TEST_ASSERT_EQUAL(usart_success, usart_rs485_enable(driver_enable));
+
+    usart_transmit_irq(data, sizeof data);
+    TEST_ASSERT_EQUAL(usart_success, usart_transmit_irq_address(0x12));
+    TEST_ASSERT_EQUAL(1 << 2, PORTD & 1 << 2);
+    usart_transmit_irq(data, sizeof data);
+    TEST_ASSERT_EQUAL(usart_success, usart_transmit_irq_address(0x34));
+    TEST_ASSERT_EQUAL(usart_success, usart_transmit_irq_address(0x56));
+    usart_transmit_irq(data, 1);
+
+    // Flush waits for the transmit complete interrupt in RS-485 mode, without
+    // a register access that would move the time of the model.
+    mock_advance((sizeof expected + 1) * NINE_BIT_FRAME_CYCLES);
+    TEST_ASSERT_EQUAL(0, PORTD & 1 << 2);
+
+    count = mock_usart_get_transmitted(&bytes);
+    TEST_ASSERT_EQUAL(sizeof expected, count);
+    for (i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(expected[i], bytes[i].data);
+        TEST_ASSERT_EQUAL(ninth_bits[i], bytes[i].ninth_bit);
+    }
+    TEST_ASSERT_EQUAL(0, UCSR0B & 1 << TXB80);
+
+    // Address frame isn't queued when the buffer is full.
+    while (usart_transmit_irq(data, sizeof data) > 0) {
+    }
+    TEST_ASSERT_EQUAL(usart_error_overrun, usart_transmit_irq_address(0x12));
+    mock_advance((USART_TX_BUFFER_SIZE + 2) * NINE_BIT_FRAME_CYCLES);
+    usart_rs485_disable();
+}
+
+/**
+ * Blocking receive reads each byte within a few register accesses after its
+ * stop bit.
+ */
+void test_model_receive() {
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = {0x55, 0x00, 0xFF, 0x55};
+    uint8_t received[sizeof data];
+    uint16_t i;
+
+    init_model();
+    mock_usart_inject(data, sizeof data);
+
+    TEST_ASSERT_EQUAL(usart_success,
+                      usart_receive(NULL, received, sizeof received));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, received, sizeof data);
+
+    TEST_ASSERT_EQUAL(sizeof data, mock_usart_get_received(&bytes));
+    for (i = 0; i < sizeof data; i++) {
+        TEST_ASSERT_EQUAL((i + 1) * FRAME_CYCLES, bytes[i].end);
+        TEST_ASSERT_UINT32_WITHIN(ACCESS_CYCLES_MAX, bytes[i].end,
+                                  bytes[i].read);
+    }
+}
+
+/**
+ * Echoing a byte, while the same byte waits in the receive buffer, is a write
+ * and not a read.
+ */
+void test_model_echo() {
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = {'a', 'a'};
+    uint8_t received;
+
+    init_model();
+    mock_usart_inject(data, sizeof data);
+    mock_advance(sizeof data * FRAME_CYCLES);
+
+    TEST_ASSERT_EQUAL(usart_success, usart_receive(NULL, &received, 1));
+    TEST_ASSERT_EQUAL(usart_success, usart_transmit(NULL, &received, 1));
+    mock_advance(FRAME_CYCLES);
+
+    TEST_ASSERT_EQUAL(1, mock_usart_get_transmitted(&bytes));
+    TEST_ASSERT_EQUAL('a', bytes[0].data);
+    TEST_ASSERT_TRUE(UCSR0A & (1 << RXC0));
+}
+
+/**
+ * Receive buffer holds 2 bytes, the rest are lost if they are not read.
+ */
+void test_model_receive_overrun() {
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = {1, 2, 3, 4};
+    uint8_t received[2];
+
+    init_model();
+    mock_usart_inject(data, sizeof data);
+    mock_advance(sizeof data * FRAME_CYCLES);
+
+    TEST_ASSERT_TRUE(UCSR0A & (1 << DOR0));
+    TEST_ASSERT_EQUAL(usart_error_overrun, usart_receive(NULL, received, 1));
+    TEST_ASSERT_EQUAL(usart_success, usart_receive(NULL, received + 1, 1));
+    TEST_ASSERT_EQUAL(1, received[0]);
+    TEST_ASSERT_EQUAL(2, received[1]);
+    TEST_ASSERT_FALSE(UCSR0A & (1 << RXC0));
+
+    mock_usart_get_received(&bytes);
+    TEST_ASSERT_FALSE(bytes[1].is_overrun);
+    TEST_ASSERT_TRUE(bytes[2].is_overrun);
+    TEST_ASSERT_TRUE(bytes[3].is_overrun);
+}
+
+/**
+ * Receive interrupt empties the hardware buffer within the same step, so a
+ * long burst is not lost.
+ */
+void test_model_receive_irq() {
+    const struct mock_usart_byte *bytes;
+    uint8_t data[48], received[sizeof data];
+    uint16_t i;
+
+    init_model();
+    for (i = 0; i < sizeof data; i++) {
+        data[i] = 0xA0 + i;
+    }
+
+    usart_receive_irq_enable();
+    mock_usart_inject(data, sizeof data);
+    mock_advance(sizeof data * FRAME_CYCLES);
+
+    TEST_ASSERT_EQUAL(sizeof data, usart_receive_irq_available());
+    TEST_ASSERT_EQUAL(sizeof data,
+                      usart_receive_irq_read_bulk(received, sizeof received));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, received, sizeof data);
+
+    // Interrupt reads each byte within a few register accesses. Only the
+    // accesses take time in the model, so this is a lower bound of the
+    // latency on the hardware.
+    mock_usart_get_received(&bytes);
+    for (i = 0; i < sizeof data; i++) {
+        TEST_ASSERT_UINT32_WITHIN(ACCESS_CYCLES_MAX, bytes[i].end,
+                                  bytes[i].read);
+    }
+    usart_receive_irq_disable();
+}
+
+/**
+ * In master SPI mode, the model loops the transmitted bytes back. Transfer
+ * keeps the transmit buffer ahead, so bytes are back to back at F_CPU / 2.
+ */
+void test_model_spi_transfer() {
+    struct usart_spi_t spi = {
+        .clock_rate = 8000000,
+        .mode = usart_spi_mode_0,
+        .is_lsb_first = 0,
+    };
+    const struct mock_usart_byte *bytes;
+    const uint8_t data[] = {0x03, 0x00, 0x10, 0x00, 0xAA, 0x55};
+    uint8_t received[sizeof data];
+    uint16_t i, count;
+
+    TEST_ASSERT_EQUAL(usart_success, usart_spi_init(&spi));
+    mock_usart_enable();
+
+    TEST_ASSERT_EQUAL(usart_success,
+                      usart_spi_transfer(data, received, sizeof data));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, received, sizeof data);
+
+    count = mock_usart_get_transmitted(&bytes);
+    TEST_ASSERT_EQUAL(sizeof data, count);
+    for (i = 1; i < count; i++) {
+        TEST_ASSERT_EQUAL(bytes[i - 1].end, bytes[i].start);
+        TEST_ASSERT_EQUAL(16, bytes[i].end - bytes[i].start);
+    }
+}
+
+/**
+ * Compile-time baud rate selects the more accurate mode, and doesn't clear a
+ * pending transmit complete flag.
+ */
+void test_model_set_baud_rate() {
+    const uint8_t data = 0x5A;
+
+    init_model();
+    usart_transmit(NULL, (uint8_t *)&data, 1);
+    mock_advance(FRAME_CYCLES);
+    TEST_ASSERT_TRUE(UCSR0A & (1 << TXC0));
+
+    // 2.1% error in normal mode, 0.8% in double speed mode.
+    USART_SET_BAUD_RATE(57600);
+    TEST_ASSERT_EQUAL(0, UBRR0H);
+    TEST_ASSERT_EQUAL(34, UBRR0L);
+    TEST_ASSERT_TRUE(UCSR0A & (1 << U2X0));
+    TEST_ASSERT_TRUE(UCSR0A & (1 << TXC0));
+
+    // Same error in both modes, normal mode is preferred.
+    USART_SET_BAUD_RATE(9600);
+    TEST_ASSERT_EQUAL(103, UBRR0L);
+    TEST_ASSERT_FALSE(UCSR0A & (1 << U2X0));
+    TEST_ASSERT_TRUE(UCSR0A & (1 << TXC0));
+}
+
+/**
+ * Sync byte of the baud rate detection.
+ */
+static const uint8_t sync_byte = 0x55;
+
+/**
+ * Sets up timer1 like an application that uses it, with a prescaler, a
+ * pending overflow and its interrupt enabled.
+ */
+static void init_application_timer1() {
+    TCCR1B = 1 << CS11;
+    TCNT1 = 0x1234;
+    TIFR1 = 1 << TOV1;
+    TIMSK1 = 1 << TOIE1;
+}
+
+/**
+ * Checks that timer1, the receiver and the interrupts are given back as they
+ * were before the baud rate detection.
+ */
+static void assert_detect_baud_rate_restored() {
+    TEST_ASSERT_EQUAL(1 << CS11, TCCR1B);
+    TEST_ASSERT_EQUAL(0x1234, TCNT1);
+    TEST_ASSERT_EQUAL(1 << TOV1, TIFR1);
+    TEST_ASSERT_EQUAL(1 << TOIE1, TIMSK1);
+    TEST_ASSERT_TRUE(UCSR0B & (1 << RXEN0));
+    TEST_ASSERT_TRUE(SREG & (1 << SREG_I));
+}
+
+/**
+ * Sync byte at 9600 bps, 1667 cycles per bit, has the same error in both
+ * modes, so normal mode is selected.
+ */
+void test_detect_baud_rate() {
+    uint32_t baud_rate;
+
+    init_model();
+    init_application_timer1();
+
+    mock_usart_inject_idle(10000);
+    mock_usart_inject_bit_time(&sync_byte, 1, 1667);
+
+    TEST_ASSERT_EQUAL(usart_success, usart_detect_baud_rate(100, &baud_rate));
+    TEST_ASSERT_UINT32_WITHIN(10, 9600, baud_rate);
+    TEST_ASSERT_EQUAL(0, UBRR0H);
+    TEST_ASSERT_EQUAL(103, UBRR0L);
+    TEST_ASSERT_FALSE(UCSR0A & (1 << U2X0));
+
+    assert_detect_baud_rate_restored();
+}
+
+/**
+ * Sync byte at 115200 bps, 139 cycles per bit, is more accurate in double
+ * speed mode.
+ */
+void test_detect_baud_rate_double_speed() {
+    uint32_t baud_rate;
+
+    init_model();
+    init_application_timer1();
+
+    mock_usart_inject_idle(10000);
+    mock_usart_inject_bit_time(&sync_byte, 1, 139);
+
+    TEST_ASSERT_EQUAL(usart_success, usart_detect_baud_rate(100, &baud_rate));
+    TEST_ASSERT_UINT32_WITHIN(1000, 115200, baud_rate);
+    TEST_ASSERT_EQUAL(0, UBRR0H);
+    TEST_ASSERT_EQUAL(16, UBRR0L);
+    TEST_ASSERT_TRUE(UCSR0A & (1 << U2X0));
+
+    assert_detect_baud_rate_restored();
+}
+
+/**
+ * Timeout is counted in timer1 overflows, so 10 ms is rounded up to 3 of them.
+ */
+void test_detect_baud_rate_timeout() {
+    init_model();
+    init_application_timer1();
+
+    TEST_ASSERT_EQUAL(usart_error_timeout, usart_detect_baud_rate(10, NULL));
+    TEST_ASSERT_UINT32_WITHIN(100, 3 * 65536UL, mock_get_time());
+
+    assert_detect_baud_rate_restored();
+}
+
+/**
+ * Bit by bit CRC-16/CCITT, as a reference for the driver's.
+ */
+static uint16_t reference_crc(const uint8_t *data, uint16_t len) {
+    uint16_t crc = 0xFFFF;
+    uint8_t bit;
+
+    while (len--) {
+        crc ^= (uint16_t)*data++ << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc;
+}
+
+/**
+ * Append big endian CRC to a payload.
+ *
+ * @returns Length of the payload with its CRC.
+ */
+static uint16_t append_crc(uint8_t *frame, uint16_t len) {
+    uint16_t crc = reference_crc(frame, len);
+
+    frame[len] = crc >> 8;
+    frame[len + 1] = crc & 0xFF;
+
+    return len + 2;
+}
+
+/**
+ * COBS encode a frame, followed by the delimiter.
+ *
+ * @returns Encoded length.
+ */
+static uint16_t encode_cobs(const uint8_t *frame, uint16_t len,
+                            uint8_t *encoded) {
+    uint16_t code_index, out, i;
+
+    code_index = 0;
+    out = 1;
+    for (i = 0; i < len; i++) {
+        if (frame[i] != 0) {
+            encoded[out++] = frame[i];
+        }
+        if (frame[i] == 0 || out - code_index == 0xFF) {
+            encoded[code_index] = out - code_index;
+            code_index = out++;
+        }
+    }
+    encoded[code_index] = out - code_index;
+    encoded[out++] = 0x00;
+
+    return out;
+}
+
+/**
+ * SLIP encode a frame, followed by the delimiter.
+ *
+ * @returns Encoded length.
+ */
+static uint16_t encode_slip(const uint8_t *frame, uint16_t len,
+                            uint8_t *encoded) {
+    uint16_t out, i;
+
+    out = 0;
+    for (i = 0; i < len; i++) {
+        if (frame[i] == 0xC0) {
+            encoded[out++] = 0xDB;
+            encoded[out++] = 0xDC;
+        } else if (frame[i] == 0xDB) {
+            encoded[out++] = 0xDB;
+            encoded[out++] = 0xDD;
+        } else {
+            encoded[out++] = frame[i];
+        }
+    }
+    encoded[out++] = 0xC0;
+
+    return out;
+}
+
+static uint8_t frame_a[255], frame_b[255];
+
+/**
+ * Enables the USART model and receiving with the given framing.
+ */
+static void init_framing(enum usart_framing framing, uint8_t size) {
+    struct usart_errors errors;
+
+    init_model();
+    usart_receive_irq_set_framing(framing, frame_a, frame_b, size);
+    usart_receive_irq_get_errors(&errors);
+    usart_receive_irq_enable();
+}
+
+static void deinit_framing() {
+    usart_receive_irq_disable();
+    usart_receive_irq_set_framing(usart_framing_none, NULL, NULL, 0);
+}
+
+/**
+ * Injects encoded bytes and waits until they are received.
+ */
+static void inject_and_wait(const uint8_t *data, uint16_t len) {
+    mock_usart_inject(data, len);
+    mock_advance(len * FRAME_CYCLES);
+}
+
+/**
+ * Checks that the published frame is `payload`, in `buffer`, then releases it.
+ */
+static void assert_frame(const uint8_t *payload, uint8_t len,
+                         const uint8_t *buffer) {
+    const uint8_t *frame;
+    uint8_t length;
+
+    TEST_ASSERT_EQUAL(usart_success,
+                      usart_receive_irq_get_frame(&frame, &length));
+    TEST_ASSERT_EQUAL(len, length);
+    TEST_ASSERT_TRUE(frame == buffer);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, frame, len);
+    usart_receive_irq_release_frame();
+}
+
+/**
+ * Zeros inside and at the end of the frame are restored from the code bytes.
+ */
+void test_frame_cobs() {
+    uint8_t frame[16], encoded[32];
+    const uint8_t payload[] = {0x11, 0x00, 0x00, 0x22, 0x33, 0x00};
+    uint16_t len;
+
+    init_framing(usart_framing_cobs, sizeof frame_a);
+
+    memcpy(frame, payload, sizeof payload);
+    len = encode_cobs(frame, append_crc(frame, sizeof payload), encoded);
+    inject_and_wait(encoded, len);
+
+    assert_frame(payload, sizeof payload, frame_a);
+    TEST_ASSERT_EQUAL(usart_error_underrun,
+                      usart_receive_irq_get_frame(NULL, NULL));
+
+    deinit_framing();
+}
+
+/**
+ * A block of 254 bytes, with the 0xFF code byte, isn't followed by a zero.
+ */
+void test_frame_cobs_long_block() {
+    uint8_t frame[254], encoded[260];
+    uint16_t len, i;
+
+    init_framing(usart_framing_cobs, sizeof frame_a);
+
+    for (i = 0; i < 252; i++) {
+        frame[i] = i + 1;
+    }
+    len = encode_cobs(frame, append_crc(frame, 252), encoded);
+    TEST_ASSERT_EQUAL(0xFF, encoded[0]);
+    inject_and_wait(encoded, len);
+
+    assert_frame(frame, 252, frame_a);
+
+    deinit_framing();
+}
+
+/**
+ * Special characters are escaped in SLIP.
+ */
+void test_frame_slip() {
+    uint8_t frame[16], encoded[32];
+    const uint8_t payload[] = {0xC0, 0x01, 0xDB, 0xDC, 0xDD, 0x00};
+    uint16_t len;
+
+    init_framing(usart_framing_slip, sizeof frame_a);
+
+    memcpy(frame, payload, sizeof payload);
+    len = encode_slip(frame, append_crc(frame, sizeof payload), encoded);
+    inject_and_wait(encoded, len);
+
+    assert_frame(payload, sizeof payload, frame_a);
+
+    deinit_framing();
+}
+
+/**
+ * Frames with a wrong CRC, an invalid escape, or that are too long for the
+ * buffers are dropped. Following frames are still received.
+ */
+void test_frame_errors() {
+    struct usart_errors errors;
+    uint8_t frame[16], encoded[40];
+    const uint8_t payload[] = {1, 2, 3, 4};
+    const uint8_t bad_escape[] = {0x01, 0xDB, 0x01, 0xC0};
+    uint16_t len;
+
+    init_framing(usart_framing_slip, 8);
+
+    // Wrong CRC.
+    memcpy(frame, payload, sizeof payload);
+    append_crc(frame, sizeof payload);
+    frame[sizeof payload + 1] ^= 1;
+    len = encode_slip(frame, sizeof payload + 2, encoded);
+    inject_and_wait(encoded, len);
+
+    // Invalid escape.
+    inject_and_wait(bad_escape, sizeof bad_escape);
+
+    // 10 bytes with the CRC, into 8 byte buffers.
+    memset(frame, 0x5A, 8);
+    len = encode_slip(frame, append_crc(frame, 8), encoded);
+    inject_and_wait(encoded, len);
+
+    // Consecutive delimiters are not frames, and not errors.
+    inject_and_wait(bad_escape + 3, 1);
+
+    TEST_ASSERT_EQUAL(usart_error_underrun,
+                      usart_receive_irq_get_frame(NULL, NULL));
+    usart_receive_irq_get_errors(&errors);
+    TEST_ASSERT_EQUAL(3, errors.frame);
+
+    memcpy(frame, payload, sizeof payload);
+    len = encode_slip(frame, append_crc(frame, sizeof payload), encoded);
+    inject_and_wait(encoded, len);
+    assert_frame(payload, sizeof payload, frame_a);
+
+    deinit_framing();
+}
+
+/**
+ * Frames are decoded into the buffers in turns. A frame is dropped while both
+ * of the buffers are full.
+ */
+void test_frame_buffer_swap() {
+    struct usart_errors errors;
+    uint8_t frames[3][8], encoded[3][16];
+    uint16_t lens[3];
+    uint8_t i;
+
+    init_framing(usart_framing_cobs, sizeof frame_a);
+
+    for (i = 0; i < 3; i++) {
+        frames[i][0] = i + 1;
+        frames[i][1] = 0;
+        lens[i] = encode_cobs(frames[i], append_crc(frames[i], 2), encoded[i]);
+    }
+
+    inject_and_wait(encoded[0], lens[0]);
+    inject_and_wait(encoded[1], lens[1]);
+    usart_receive_irq_get_errors(&errors);
+    TEST_ASSERT_EQUAL(1, errors.buffer_overrun);
+    assert_frame(frames[0], 2, frame_a);
+
+    inject_and_wait(encoded[2], lens[2]);
+    assert_frame(frames[2], 2, frame_b);
+
+    inject_and_wait(encoded[0], lens[0]);
+    assert_frame(frames[0], 2, frame_a);
+
+    deinit_framing();
+}
+
+/**
+ * Data overrun on a delimiter drops the frame that it ends, but the next frame
+ * is still decoded. USART model can't put DOR0 on a chosen byte, so the
+ * interrupt is called directly.
+ */
+void test_frame_overrun_on_delimiter() {
+    struct usart_errors errors;
+    uint8_t frame[8], encoded[16];
+    const uint8_t payload[] = {0xAB, 0xCD};
+    uint16_t len, i;
+
+    usart_receive_irq_set_framing(usart_framing_cobs, frame_a, frame_b,
+                                  sizeof frame_a);
+    usart_receive_irq_get_errors(&errors);
+
+    memcpy(frame, payload, sizeof payload);
+    len = encode_cobs(frame, append_crc(frame, sizeof payload), encoded);
+
+    for (i = 0; i < 2 * len; i++) {
+        UCSR0A = i == len - 1 ? 1 << DOR0 : 0;
+        UDR0 = encoded[i % len];
+        USART_RX_vect();
+    }
+
+    usart_receive_irq_get_errors(&errors);
+    TEST_ASSERT_EQUAL(1, errors.overrun);
+    TEST_ASSERT_EQUAL(1, errors.frame);
+
+    // Dropped frame's buffer is reused.
+    assert_frame(payload, sizeof payload, frame_a);
+
+    deinit_framing();
+}
+
+/**
+ * Checks the transmitted bytes of the USART model.
+ */
+static void assert_transmitted(const char *expected) {
+    const struct mock_usart_byte *bytes;
+    uint16_t i, count;
+
+    count = mock_usart_get_transmitted(&bytes);
+    TEST_ASSERT_EQUAL(strlen(expected), count);
+    for (i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(expected[i], bytes[i].data);
+    }
+}
+
+void test_stdio() {
+    const uint8_t data[] = "ab";
+
+    init_model();
+    usart_stdio_init();
+
+    // New line is sent with a carriage return.
+    TEST_ASSERT_EQUAL('o', mock_stdio_putc('o'));
+    TEST_ASSERT_EQUAL('k', mock_stdio_putc('k'));
+    TEST_ASSERT_EQUAL('\n', mock_stdio_putc('\n'));
+    mock_advance(4 * FRAME_CYCLES);
+    assert_transmitted("ok\r\n");
+
+    mock_usart_inject(data, 2);
+    TEST_ASSERT_EQUAL('a', mock_stdio_getc());
+
+    // Disabled timeout waits for the char too.
+    usart_stdio_set_timeout(0);
+    TEST_ASSERT_EQUAL('b', mock_stdio_getc());
+}
+
+void test_stdio_buffered() {
+    uint8_t data[USART_TX_BUFFER_SIZE - 1];
+    char expected[sizeof "ok\r\n" + sizeof data + 1];
+
+    init_model();
+    usart_stdio_init_buffered();
+
+    TEST_ASSERT_EQUAL('o', mock_stdio_putc('o'));
+    TEST_ASSERT_EQUAL('k', mock_stdio_putc('k'));
+    TEST_ASSERT_EQUAL('\n', mock_stdio_putc('\n'));
+    usart_stdio_flush();
+    assert_transmitted("ok\r\n");
+
+    // Time of the model doesn't move while queuing, so the buffer isn't
+    // emptied. A full buffer drops chars instead of blocking, and a line
+    // ending is dropped as a whole.
+    memset(data, 'x', sizeof data);
+    TEST_ASSERT_EQUAL(sizeof data, usart_transmit_irq(data, sizeof data));
+    TEST_ASSERT_EQUAL(EOF, mock_stdio_putc('\n'));
+    TEST_ASSERT_EQUAL('y', mock_stdio_putc('y'));
+    TEST_ASSERT_EQUAL(EOF, mock_stdio_putc('z'));
+    usart_stdio_flush();
+
+    strcpy(expected, "ok\r\n");
+    memcpy(expected + 4, data, sizeof data);
+    strcpy(expected + 4 + sizeof data, "y");
+    assert_transmitted(expected);
+}
+
+/**
+ * Checks the formatted string and its returned length.
+ */
+static void assert_format(const char *expected, uint8_t length,
+                          const char *buffer) {
+    TEST_ASSERT_EQUAL_STRING(expected, buffer);
+    TEST_ASSERT_EQUAL(strlen(expected), length);
+}
+
+void test_format_uint() {
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    assert_format("0", usart_format_uint(buffer, 0), buffer);
+    assert_format("7", usart_format_uint(buffer, 7), buffer);
+    assert_format("1000", usart_format_uint(buffer, 1000), buffer);
+    assert_format("4294967295", usart_format_uint(buffer, UINT32_MAX), buffer);
+}
+
+void test_format_int() {
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    assert_format("0", usart_format_int(buffer, 0), buffer);
+    assert_format("-1", usart_format_int(buffer, -1), buffer);
+    assert_format("2147483647", usart_format_int(buffer, INT32_MAX), buffer);
+    assert_format("-2147483648", usart_format_int(buffer, INT32_MIN), buffer);
+}
+
+void test_format_hex() {
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    assert_format("0", usart_format_hex(buffer, 0, 1), buffer);
+    assert_format("000A", usart_format_hex(buffer, 0x0A, 4), buffer);
+    assert_format("DEADBEEF", usart_format_hex(buffer, 0xDEADBEEF, 8), buffer);
+
+    // Truncated to the digits.
+    assert_format("EF", usart_format_hex(buffer, 0xDEADBEEF, 2), buffer);
+}
+
+void test_format_hex_illegal() {
+    SKIP_IN_RELEASE_BUILD();
+
+#if !defined(HAL_RELEASE_BUILD)
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    TEST_ASSERT_EQUAL(0, usart_format_hex(buffer, 0, 0));
+    TEST_ASSERT_EQUAL(0, usart_format_hex(buffer, 0, 9));
+#endif // HAL_RELEASE_BUILD
+}
+
+void test_format_fixed() {
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    assert_format("123.45", usart_format_fixed(buffer, 12345, 2), buffer);
+    assert_format("123", usart_format_fixed(buffer, 123, 0), buffer);
+    assert_format("1.00", usart_format_fixed(buffer, 100, 2), buffer);
+    assert_format("0.00", usart_format_fixed(buffer, 0, 2), buffer);
+
+    // Fraction is padded with zeros, not rounded.
+    assert_format("0.05", usart_format_fixed(buffer, 5, 2), buffer);
+    assert_format("0.999", usart_format_fixed(buffer, 999, 3), buffer);
+    assert_format("0.000000005", usart_format_fixed(buffer, 5, 9), buffer);
+}
+
+void test_format_fixed_negative() {
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    assert_format("-0.05", usart_format_fixed(buffer, -5, 2), buffer);
+    assert_format("-12.3", usart_format_fixed(buffer, -123, 1), buffer);
+    assert_format("-2.147483648", usart_format_fixed(buffer, INT32_MIN, 9),
+                  buffer);
+}
+
+void test_format_fixed_illegal() {
+    SKIP_IN_RELEASE_BUILD();
+
+#if !defined(HAL_RELEASE_BUILD)
+    char buffer[USART_FORMAT_BUFFER_SIZE];
+
+    TEST_ASSERT_EQUAL(0, usart_format_fixed(buffer, 0, 10));
+#endif // HAL_RELEASE_BUILD
 }
 
 void setUp() {
@@ -152,6 +992,33 @@ int main() {
     RUN_TEST(test_synchronous_master);
     RUN_TEST(test_stop_bits_legal);
     RUN_TEST(test_stop_bits_illegal);
+    RUN_TEST(test_model_transmit_throughput);
+    RUN_TEST(test_model_transmit_irq);
+    RUN_TEST(test_model_transmit_irq_address);
+    RUN_TEST(test_stdio);
+    RUN_TEST(test_stdio_buffered);
+    RUN_TEST(test_model_receive);
+    RUN_TEST(test_model_echo);
+    RUN_TEST(test_model_receive_overrun);
+    RUN_TEST(test_model_receive_irq);
+    RUN_TEST(test_model_spi_transfer);
+    RUN_TEST(test_model_set_baud_rate);
+    RUN_TEST(test_detect_baud_rate);
+    RUN_TEST(test_detect_baud_rate_double_speed);
+    RUN_TEST(test_detect_baud_rate_timeout);
+    RUN_TEST(test_frame_cobs);
+    RUN_TEST(test_frame_cobs_long_block);
+    RUN_TEST(test_frame_slip);
+    RUN_TEST(test_frame_errors);
+    RUN_TEST(test_frame_buffer_swap);
+    RUN_TEST(test_frame_overrun_on_delimiter);
+    RUN_TEST(test_format_uint);
+    RUN_TEST(test_format_int);
+    RUN_TEST(test_format_hex);
+    RUN_TEST(test_format_hex_illegal);
+    RUN_TEST(test_format_fixed);
+    RUN_TEST(test_format_fixed_negative);
+    RUN_TEST(test_format_fixed_illegal);
 
     return UnityEnd();
 }